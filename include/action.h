@@ -0,0 +1,95 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+#include "node.h"
+
+// Everything an input device can ask the controller to do. Actions are a
+// few bytes and trivially copyable, so emitting one never allocates. Their
+// names are only used where they are read from the config or written out.
+struct Action {
+    enum class Type : uint8_t {
+        NONE = 0,
+        MOVE,
+        BACK,
+        EXIT,
+        SHOW,
+        // Shows the overlay, or hides it if it is already showing
+        TOGGLE,
+        // Starts typing a query, the keyboard handles this itself
+        SEARCH,
+        // Adds a character to the query
+        SEARCH_TYPE,
+        // Removes the last character of the query
+        SEARCH_ERASE,
+        // Ends the search, going back to the grid
+        SEARCH_CANCEL,
+        // Launches the best match
+        SEARCH_RUN
+    };
+    
+    // Longest UTF-8 sequence
+    static constexpr size_t MAX_TEXT = 4;
+    
+    constexpr Action(Type type = Type::NONE,
+                     Direction direction = Direction::INVALID) :
+        type(type), direction(direction), text{} { }
+        
+    static constexpr Action move(Direction direction) {
+        return Action(Type::MOVE, direction);
+    }
+    
+    // Types the UTF-8 character at the start of text
+    static Action character(const char* text, size_t length);
+    
+    // Number of bytes in the UTF-8 sequence starting with lead
+    static constexpr size_t getCharacterLength(char lead) {
+        return (lead & 0x80) == 0x00 ? 1 :
+               (lead & 0xE0) == 0xC0 ? 2 :
+               (lead & 0xF0) == 0xE0 ? 3 :
+               (lead & 0xF8) == 0xF0 ? 4 : 1;
+    }
+    
+    size_t getTextLength() const {
+        return strnlen(text, MAX_TEXT);
+    }
+    
+    bool operator==(const Action& other) const {
+        return type == other.type && direction == other.direction &&
+               std::memcmp(text, other.text, MAX_TEXT) == 0;
+    }
+    
+    bool operator!=(const Action& other) const {
+        return !(*this == other);
+    }
+    
+    // Moves are named after their direction, e.g. "ul", and typing is
+    // written as SEARCH_TYPE: followed by the character. Unknown names
+    // give a NONE action.
+    std::string toString() const;
+    static Action fromString(const std::string& name);
+    
+    Type type;
+    // Only used by MOVE
+    Direction direction;
+    // Only used by SEARCH_TYPE, padded with zeroes
+    char text[MAX_TEXT];
+};
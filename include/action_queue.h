@@ -0,0 +1,86 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "action.h"
+
+// Bounded lock-free queue of actions with many producers and one consumer.
+// Input devices push from their own threads, and only the GUI thread pops,
+// so the model and the widgets are only ever touched from that thread. A
+// full queue drops the action rather than making its producer wait.
+class ActionQueue {
+  public:
+    struct Statistics {
+        uint64_t pushed;
+        // Actions dropped because the queue was full
+        uint64_t dropped;
+        uint64_t popped;
+        // Time between being pushed and popped
+        double meanLatencyMs;
+        double maxLatencyMs;
+    };
+    
+    // Capacity is rounded up to a power of two
+    explicit ActionQueue(size_t capacity = CAPACITY);
+    
+    ActionQueue(const ActionQueue&) = delete;
+    ActionQueue& operator=(const ActionQueue&) = delete;
+    
+    // Safe to call from any thread. Returns false if the queue is full.
+    bool push(const Action& action);
+    
+    // Only call from the consumer thread. Returns false if the queue is empty.
+    bool pop(Action& action);
+    
+    // Whether a push would fail right now. Only conclusive when there
+    // is a single producer and it is the one asking.
+    bool isFull() const;
+    
+    // Only call from the consumer thread
+    Statistics getStatistics() const;
+    
+    static constexpr size_t CAPACITY = 256;
+    
+  private:
+    // A cell can be written once its sequence equals the position being
+    // pushed, and read once it is one past the position being popped
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Action action;
+        uint64_t timestamp;
+    };
+    
+    static uint64_t now();
+    
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    
+    // Written by producers
+    std::atomic<size_t> tail;
+    std::atomic<uint64_t> pushed;
+    std::atomic<uint64_t> dropped;
+    
+    // Only touched by the consumer
+    size_t head;
+    uint64_t popped;
+    uint64_t totalLatency;
+    uint64_t maxLatency;
+};
@@ -0,0 +1,55 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "action.h"
+
+// Writes every action emitted by the input devices to a file, along with
+// when it was emitted, so that input sequences can be replayed without the
+// hardware. Each action takes a varint time delta and two to six bytes.
+class ActionRecorder {
+  public:
+    struct Entry {
+        // Microseconds since the recording started
+        uint64_t time;
+        Action action;
+    };
+    
+    // Starts a new recording, throwing if the file can't be written
+    explicit ActionRecorder(const std::string& file);
+    
+    // Safe to call from any thread
+    void record(const Action& action);
+    
+    // Reads a recording, throwing if it is missing or malformed
+    static std::vector<Entry> load(const std::string& file);
+    
+    static constexpr uint32_t VERSION = 1;
+    
+  private:
+    std::mutex mutex;
+    std::ofstream output;
+    std::chrono::steady_clock::time_point start;
+    uint64_t lastTime;
+};
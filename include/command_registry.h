@@ -0,0 +1,81 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <unordered_set>
+#include <unordered_map>
+
+#include <QIcon>
+
+#include "util.h"
+
+typedef uint32_t command_handle;
+static constexpr command_handle NO_COMMAND = 0xFFFFFFFF;
+
+// Every command the launcher knows about, stored once for the whole process.
+// Trees and everything else refer to commands by handle. Strings are
+// interned, so layouts and images that mention the same command share it,
+// and an icon is only loaded once per theme name. Handles and the references
+// handed out stay valid until the process exits. Only use from the GUI thread.
+class CommandRegistry {
+  public:
+    // Gets the handle of the command, registering it if it is new
+    static command_handle add(const std::string& name, const std::string& command,
+                              const std::string& iconName);
+                              
+    static const std::string& getName(command_handle handle);
+    static const std::string& getCommand(command_handle handle);
+    static const std::string& getIconName(command_handle handle);
+    
+    // Loaded on first use, since most icons are never shown
+    static const QIcon* getIcon(command_handle handle);
+    
+    // Number of distinct commands
+    static size_t size();
+    
+  private:
+    struct Entry {
+        const std::string* name;
+        const std::string* command;
+        const std::string* iconName;
+        uint32_t icon;
+        
+        bool operator==(const Entry& other) const {
+            return name == other.name && command == other.command &&
+                   iconName == other.iconName;
+        }
+    };
+    
+    struct EntryHash {
+        size_t operator()(const Entry& entry) const;
+    };
+    
+    static const std::string* intern(const std::string& str);
+    static const Entry& getEntry(command_handle handle);
+    
+    static std::unordered_set<std::string> strings;
+    static std::vector<Entry> entries;
+    static std::unordered_map<Entry, command_handle, EntryHash> handles;
+    
+    // Indexed by Entry::icon, null until first used
+    static std::vector<std::unique_ptr<QIcon>> icons;
+    static std::unordered_map<const std::string*, uint32_t> iconSlots;
+};
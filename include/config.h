@@ -23,6 +23,8 @@
 #include <sstream>
 #include <streambuf>
 #include <regex>
+#include <unordered_map>
+#include <vector>
 
 #include <QIcon>
 #include <QColor>
@@ -35,6 +37,8 @@
 
 #include "tinydir.h"
 #include "util.h"
+#include "grid.h"
+#include "command_registry.h"
 
 class Config {
 
@@ -43,19 +47,37 @@ class Config {
     static std::shared_ptr<Json::Value> appRoot;
     
     static std::string readFile(const std::string& filename);
-    static std::string writeFile(const std::string& filename,
-                                 const std::string& contents);
+    static void writeFile(const std::string& filename,
+                          const std::string& contents);
                                  
     static void readConfig();
     
     static std::shared_ptr<std::vector<
-    std::pair<util::Command, util::vec2i_ptr>>>
+    std::pair<command_handle, util::vec2i_ptr>>>
     readApplications();
     
+    // Reads the layouts that applications have for specific window
+    // classes, keyed by WM_CLASS. Must follow readApplications, whose
+    // output the layouts share their command handles with.
+    static std::unordered_map<std::string,
+           std::vector<std::pair<command_handle, util::vec2i_ptr>>>
+           readContexts(const std::vector<std::pair<command_handle, util::vec2i_ptr>>&
+                        applications);
+                        
+                        
     static QColor getColor(std::string name);
     
+    static GridGeometry getGrid();
+    
     static void updateApplicationList(std::string applicationDirectory);
     
     static constexpr auto CONFIG_FILE = "assets/config/config.json";
     static constexpr auto APP_FILE = "assets/config/applications.json";
+    static constexpr auto APP_IMAGE_FILE = "assets/config/applications.trie";
+    static constexpr auto HISTORY_FILE = "assets/config/history.json";
+    static constexpr auto CONTEXT_IMAGE_DIR = "assets/config/contexts";
+    
+  private:
+    static util::vec2i_ptr readPath(const Json::Value& commandPath,
+                                    const std::string& command);
 };
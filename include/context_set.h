@@ -0,0 +1,64 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+#include "grid.h"
+#include "model.h"
+#include "trie_image.h"
+
+// Command trees for specific window classes, next to the default tree used
+// everywhere else. Trees are shared rather than copied, so switching layouts
+// when the overlay opens is just a matter of handing out another pointer.
+class ContextSet {
+  public:
+    typedef std::shared_ptr<const Model::command_tree> tree_ptr;
+    
+    explicit ContextSet(tree_ptr defaultTree = nullptr);
+    
+    // Adds or replaces the tree used while a window of the given
+    // WM_CLASS has focus
+    void add(const std::string& windowClass, tree_ptr tree);
+    
+    // Gets the tree for a window class, or the default tree
+    // if the class doesn't have a layout of its own
+    const tree_ptr& get(const std::string& windowClass) const;
+    
+    const tree_ptr& getDefault() const;
+    void setDefault(tree_ptr tree);
+    
+    // Number of window classes with a layout of their own
+    size_t size() const;
+    
+    // Writes an image per window class into directory, removing
+    // images of classes that no longer have a layout
+    void compile(const std::string& directory, const std::string& sourceFile,
+                 const GridGeometry& grid) const;
+                 
+    // Maps every image in directory. Returns false, leaving the set
+    // untouched, if the directory is missing or any image is stale.
+    bool load(const std::string& directory, const std::string& sourceFile,
+              const GridGeometry& grid);
+              
+  private:
+    tree_ptr defaultTree;
+    std::unordered_map<std::string, tree_ptr> trees;
+};
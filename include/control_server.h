@@ -0,0 +1,85 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#pragma once
+
+#include <string>
+#include <functional>
+#include <unordered_map>
+
+#include <QSocketNotifier>
+#include <QEvent>
+
+#include "control_socket.h"
+
+// Unix domain socket that scripts and window manager bindings use to
+// launch applications through a running NodeUI. Everything happens on
+// the Qt event loop, so the handler can use the model directly.
+class ControlServer {
+  public:
+    typedef std::function<std::string(const std::string& request)> handler;
+    
+    // Throws if the socket can't be created, or another instance
+    // is already listening on it
+    ControlServer(const std::string& path, handler onRequest);
+    ~ControlServer();
+    
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+    
+  private:
+    // Calls back whenever its socket can be read or written without
+    // blocking, depending on the type
+    class Watcher : public QSocketNotifier {
+      public:
+        Watcher(int socket, QSocketNotifier::Type type,
+                std::function<void()> onActivated) :
+            QSocketNotifier(socket, type),
+            onActivated(onActivated) { }
+            
+      protected:
+        bool event(QEvent* event) override;
+        
+      private:
+        std::function<void()> onActivated;
+    };
+    
+    struct Client {
+        Watcher* reader;
+        // Only enabled while replies are waiting to be sent
+        Watcher* writer;
+        // Received but not yet ended by a newline
+        std::string input;
+        // Replies the socket had no room for yet
+        std::string output;
+        // Closed once the output is flushed
+        bool finished;
+    };
+    
+    void accept();
+    void read(int socket);
+    void reply(Client& client, const std::string& request);
+    // Sends as much of the output as the socket takes, and only reads
+    // from the client again once all of it went out
+    void flush(int socket);
+    void close(int socket);
+    
+    std::string path;
+    handler onRequest;
+    int listener;
+    Watcher* listenerWatcher;
+    std::unordered_map<int, Client> clients;
+};
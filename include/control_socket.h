@@ -0,0 +1,43 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#pragma once
+
+#include <string>
+#include <cstdlib>
+
+#include <unistd.h>
+
+// Protocol of the control socket, shared with NodeUI-ctl, which doesn't
+// link against Qt. Every request is a line holding either a path such as
+// "d_,r_,u_" or the name or command of an application. Every reply is a
+// line of tab separated fields, either
+//     OK  <name>  <command>  <milliseconds>
+// or
+//     ERROR  <message>
+namespace ControlSocket {
+    static constexpr size_t MAX_REQUEST = 4096;
+    static constexpr const char* REPLY_OK = "OK";
+    static constexpr const char* REPLY_ERROR = "ERROR";
+    
+    // In the runtime directory if there is one, so that every user has one
+    inline std::string getDefaultPath() {
+        const char* runtimeDirectory = std::getenv("XDG_RUNTIME_DIR");
+        if (runtimeDirectory != nullptr && runtimeDirectory[0] != '\0')
+            return std::string(runtimeDirectory) + "/nodeui.sock";
+        return "/tmp/nodeui-" + std::to_string(getuid()) + ".sock";
+    }
+}
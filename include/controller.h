@@ -21,6 +21,9 @@
 #include <unordered_map>
 #include <algorithm>
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
 
 #include <QKeyEvent>
 
@@ -28,8 +31,17 @@
 #include "node.h"
 #include "model.h"
 #include "screen.h"
+#include "action.h"
+#include "action_queue.h"
 #include "input_device.h"
 #include "keyboard_input.h"
+#include "predictor.h"
+#include "context_set.h"
+#include "search_index.h"
+#include "view_state.h"
+#include "action_recorder.h"
+#include "control_socket.h"
+#include "launch_gate.h"
 
 #if LEAP_FOUND == 1
 #include "leap_input.h"
@@ -39,61 +51,203 @@
 #include "eye_input.h"
 #endif
 
-void onReceive(std::string str, void* controller);
+void onReceive(const Action& action, void* controller);
 
 class Controller {
   public:
-    Controller(std::shared_ptr<Model> model, std::shared_ptr<UIOverlay> screen) :
+    Controller(const Model& model, const ContextSet& contexts,
+               std::shared_ptr<UIOverlay> screen) :
+        model(model),
+        contexts(contexts),
+        searchIndex(),
+        searchSession(),
+        predictor(),
+        actions(),
+        drainScheduled(false),
+        coalesced(0),
+        shown(model.getGrid()),
+        next(model.getGrid()),
+        delta(),
+        prewarm((*(Config::root))["prewarm_overlay"].asBool()),
+        recorderStorage(),
+        recorder(nullptr),
+        dryRun(false),
+        launchGate(std::chrono::milliseconds((*(Config::root)).get(
+                "launch_debounce_ms", static_cast<int>(
+                    LaunchGate::WINDOW.count())).asInt())),
+        emitFunction(),
+        pendingDevices(),
         inputDevices() {
-        this->model = model;
         this->screen = screen;
+        this->predictor.load(Config::HISTORY_FILE);
+        this->predictor.setViewWarmer([&](const Model & next) {
+            this->warmView(next);
+        });
         
-        auto receiveFunc = [&](std::string str) {
-            return onReceive(str, this);
+        // Devices may emit from threads of their own
+        this->emitFunction = [&](const Action & action) {
+            this->post(action);
         };
-        std::function<void(std::string)> func = receiveFunc;
-        inputDevices.push_back(std::shared_ptr<InputDevice>(new KeyboardInput(
-                                   func)));
+        this->addInputDevice(std::shared_ptr<InputDevice>(new KeyboardInput(
+                                 this->emitFunction)));
                                    
+        // Optional devices are slow to set up, so they are only built once
+        // the overlay has been shown
 #if LEAP_FOUND == 1
-        inputDevices.push_back(std::shared_ptr<InputDevice>(new LeapInput(
-                                   func)));
+        pendingDevices.emplace_back("Leap Motion",
+        [](InputDevice::emitter emitter) {
+            return std::shared_ptr<InputDevice>(new LeapInput(emitter));
+        });
 #endif
-                                   
+
 #if OpenCV_FOUND == 1
         if ((*(Config::root))["eye_tracking_enabled"].asBool())
-            inputDevices.push_back(std::shared_ptr<InputDevice>(new EyeInput(
-                                       func)));
+            pendingDevices.emplace_back("eye tracker",
+            [](InputDevice::emitter emitter) {
+                return std::shared_ptr<InputDevice>(new EyeInput(emitter));
+            });
 #endif
-                                       
+
         auto signalAll = [&](QKeyEvent * event) {
             for (auto device : this->inputDevices)
                 device->onKeyEvent(event);
         };
         
+        // Focus flapping only flips the state of each worker,
+        // it never creates or destroys one
         auto focusAll = [&](const bool & hasFocus) {
-            for (auto device : this->inputDevices)
+            for (auto device : this->inputDevices) {
+                if (device->followsFocus()) {
+                    if (hasFocus)
+                        device->start();
+                    else
+                        device->pause();
+                }
                 device->onFocusChange(hasFocus);
+            }
         };
         
         this->screen->setController(signalAll);
         this->screen->setFocusHandler(focusAll);
-        this->loadIcons();
+        this->screen->setWakeHandler([&]() {
+            this->drainActions();
+        });
+        this->screen->setShownHandler([&]() {
+            this->startPendingDevices();
+        });
         this->updateView();
+        if (this->prewarm)
+            this->screen->prewarm();
     }
     
+    // Workers call into the controller, so they have to end first
+    ~Controller();
+    
+    // Brings the overlay up to date with the model, or with the search
+    // results while searching, touching only the cells that changed
     void updateView();
     
     void hideAll();
-    void showAll();
-    void toggleOverlay();
     
-    friend void onReceive(std::string str, Controller* controller);
+    // Shows the layout for the given WM_CLASS, if it has one. The time
+    // it was requested at is what its first frame is timed from.
+    void showAll(const std::string& windowClass = "",
+                 std::chrono::steady_clock::time_point requested =
+                     std::chrono::steady_clock::now());
+    void toggleOverlay(const std::string& windowClass = "",
+                       std::chrono::steady_clock::time_point requested =
+                           std::chrono::steady_clock::now());
+    
+    // Queues an action to be handled on the GUI thread. Safe to call
+    // from any thread.
+    void post(const Action& action);
+    
+    // Devices added from outside, such as replays, are started by
+    // the caller unless they follow focus
+    void addInputDevice(std::shared_ptr<InputDevice> device);
+    
+    // Records every action handled from then on. Can only be set once.
+    void setRecorder(std::unique_ptr<ActionRecorder> recorder);
+    
+    // Goes through the motions of launching without running anything
+    // or counting it towards the launch history
+    void setDryRun(bool dryRun);
+    
+    void logStatistics() const;
+    
+    // Launches what a control socket request names, without showing
+    // anything, and replies with what was launched
+    std::string handleControlRequest(const std::string& request);
+    
+    const Model& getModel() const;
+    
+    // Queues toggling the overlay with the layout for the given
+    // WM_CLASS. Safe to call from any thread.
+    void postToggle(const std::string& windowClass);
+    
+    friend void onReceive(const Action& action, Controller* controller);
   private:
-    void loadIcons();
+    void applyView();
+    // Composes the mosaics a view of the model would show, without
+    // showing it
+    void warmView(const Model& model);
+    // Builds the devices that haven't been yet, leaving out
+    // the ones that fail
+    void startPendingDevices();
+    void launch(command_handle command);
+    // Runs a command and adds it to the launch history, unless the
+    // same command was launched moments ago. Returns whether it ran.
+    bool execute(command_handle command);
+    // Finds the application at a path of moves, or with a name
+    // or command, setting error if there is none
+    command_handle resolve(const std::string& request, std::string& error) const;
+    
+    // Handles every queued action, skipping the ones that can't
+    // change anything
+    void drainActions();
+    void scheduleDrain();
+    void record(const Action& action);
+    bool isRedundant(const Action& action, const Action& previous) const;
+    // Also takes when the hotkey was pressed, or the epoch if it
+    // wasn't since the last toggle
+    std::string takeWindowClass(std::chrono::steady_clock::time_point& requested);
     
-    std::shared_ptr<Model> model;
+    // Shows the best matches for a query, or goes
+    // back to the grid if the query is empty
+    void search(const std::string& query);
+    void editSearch(const Action& action);
+    void runSearch();
+    
+    Model model;
+    ContextSet contexts;
+    std::shared_ptr<const SearchIndex> searchIndex;
+    std::unique_ptr<SearchIndex::Session> searchSession;
     std::shared_ptr<UIOverlay> screen;
+    Predictor predictor;
+    
+    ActionQueue actions;
+    // Set while a drain is pending, so producers wake the GUI thread once
+    std::atomic<bool> drainScheduled;
+    uint64_t coalesced;
+    std::mutex windowClassMutex;
+    std::string windowClass;
+    std::chrono::steady_clock::time_point toggleRequested;
+    
+    // What is on screen and what should be, swapped once applied
+    ViewState shown;
+    ViewState next;
+    ViewState::Delta delta;
+    // Keeps the root view rendered while hidden
+    bool prewarm;
+    
+    // Read by producers, so only ever set once
+    std::unique_ptr<ActionRecorder> recorderStorage;
+    std::atomic<ActionRecorder*> recorder;
+    bool dryRun;
+    // Shared by every device and the control socket
+    LaunchGate launchGate;
     
+    InputDevice::emitter emitFunction;
+    std::vector<std::pair<std::string, InputDevice::factory>> pendingDevices;
     std::vector<std::shared_ptr<InputDevice>> inputDevices;
 };
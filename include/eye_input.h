@@ -17,9 +17,10 @@
 
 #pragma once
 
-#include <thread>
 #include <queue>
-#include <atomic>
+#include <future>
+#include <mutex>
+#include <memory>
 #include <iostream>
 
 #include "opencv2/photo.hpp"
@@ -33,31 +34,6 @@
 #include "input_device.h"
 #include "config.h"
 
-class EyeTracker {
-  public:
-    static std::atomic_flag stopEyeTracking;
-    
-    explicit EyeTracker();
-    
-    void stopTracking();
-    
-    void eyeTracking(std::function<void(std::string)> emitter);
-  private:
-    cv::Point computePupilLocationHough(cv::Mat eye);
-    int getIrisScore(cv::Mat iris);
-    cv::Point computePupilLocation(cv::Mat eye);
-    void test_center(const int& x, const int& y, cv::Mat weight, double gX,
-                     double gY, cv::Mat& out);
-    cv::Mat computeMaxGradient(cv::Mat eye);
-    cv::Mat computeMagnitudes(cv::Mat mat1, cv::Mat mat2);
-    double computeDynamicThreshold(cv::Mat mat, double stdDevFactor);
-    cv::Mat floodKillEdges(cv::Mat& mat);
-    cv::Mat resizeIdeal(cv::Mat image);
-    void resizeAndRender(cv::Mat image, const std::string& name);
-    
-    cv::CascadeClassifier eye_cascade;
-};
-
 template<class T>
 class StabilizedMedian {
   public:
@@ -97,15 +73,72 @@ class StabilizedMedian {
     int size;
 };
 
+class EyeTracker {
+  public:
+    // Starts loading the cascade in the background if nothing has yet
+    explicit EyeTracker();
+    
+    // Opens the camera, waiting for the cascade if it is still loading.
+    // Throws if either of them fails.
+    void begin();
+    // Tracks the eyes in a single frame, returning false if
+    // the camera didn't deliver one
+    bool track();
+    void end();
+    
+  private:
+    cv::Point computePupilLocationHough(cv::Mat eye);
+    int getIrisScore(cv::Mat iris);
+    cv::Point computePupilLocation(cv::Mat eye);
+    void test_center(const int& x, const int& y, cv::Mat weight, double gX,
+                     double gY, cv::Mat& out);
+    cv::Mat computeMaxGradient(cv::Mat eye);
+    cv::Mat computeMagnitudes(cv::Mat mat1, cv::Mat mat2);
+    double computeDynamicThreshold(cv::Mat mat, double stdDevFactor);
+    cv::Mat floodKillEdges(cv::Mat& mat);
+    cv::Mat resizeIdeal(cv::Mat image);
+    void resizeAndRender(cv::Mat image, const std::string& name);
+    
+    typedef std::shared_future<std::shared_ptr<cv::CascadeClassifier>>
+            cascade_future;
+            
+    // Parsing the cascade takes a while, so it is done once, off the GUI
+    // thread. Getting a cascade that failed to load throws.
+    static cascade_future loadCascade();
+    
+    cascade_future eye_cascade;
+    std::shared_ptr<cv::CascadeClassifier> cascade;
+    
+    cv::VideoCapture capture;
+    std::pair<cv::Rect, cv::Rect> eyeRects;
+    std::pair<StabilizedMedian<int>, StabilizedMedian<int>> left_eye_median;
+    std::pair<StabilizedMedian<int>, StabilizedMedian<int>> right_eye_median;
+    uint64_t lastTimestamp;
+};
+
 class EyeInput : public InputDevice {
   public:
-    EyeInput(std::function<void(std::string)> emitter):
-        InputDevice(emitter),
+    EyeInput(emitter emitFunction):
+        InputDevice(emitFunction),
         tracker() { }
-        
+    ~EyeInput();
+    
+    std::string getName() const;
+    
     virtual void onKeyEvent(QKeyEvent* event);
     void onFocusChange(const bool& hasFocus);
+    
+  protected:
+    bool hasWorker() const;
+    void onWorkerStart();
+    void onWorkerPause();
+    bool work();
+    
+    // How long to wait for the camera after a dropped frame
+    static constexpr int RETRY_DELAY_MS = 100;
+    
   private:
+    // Only used from the worker
     EyeTracker tracker;
 };
 
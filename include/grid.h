@@ -0,0 +1,145 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "util.h"
+#include "node.h"
+
+static constexpr int DEFAULT_GRID_SIZE = 3;
+
+// Neighbour indices (-1 if the move leaves the grid) and normalized node
+// centers for every cell of a W x H grid. Cells are indexed row by row.
+template <int W, int H>
+struct GridTables {
+    int neighbours[W * H][NUM_DIRECTIONS];
+    double centers[W * H][2];
+};
+
+template <int W, int H>
+constexpr GridTables<W, H> makeGridTables() {
+    GridTables<W, H> tables {};
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            const int cell = y * W + x;
+            tables.centers[cell][0] = (x + 0.5) / W;
+            tables.centers[cell][1] = (y + 0.5) / H;
+            for (int d = 0; d < NUM_DIRECTIONS; d++) {
+                const int nx = x + DIRECTION_DELTAS[d][0];
+                const int ny = y + DIRECTION_DELTAS[d][1];
+                tables.neighbours[cell][d] =
+                    (nx >= 0 && nx < W && ny >= 0 && ny < H) ? ny * W + nx : -1;
+            }
+        }
+    }
+    return tables;
+}
+
+// Geometry of a W x H grid, computed entirely at compile time
+template <int W, int H>
+struct Grid {
+    static constexpr int WIDTH = W;
+    static constexpr int HEIGHT = H;
+    static constexpr GridTables<W, H> TABLES = makeGridTables<W, H>();
+};
+
+template <int W, int H>
+constexpr int Grid<W, H>::WIDTH;
+template <int W, int H>
+constexpr int Grid<W, H>::HEIGHT;
+template <int W, int H>
+constexpr GridTables<W, H> Grid<W, H>::TABLES;
+
+// Geometry of the grid in use. Common sizes read the tables of the matching
+// Grid specialization, any other size computes them once when created.
+// Copies share the tables.
+class GridGeometry {
+  public:
+    GridGeometry() : GridGeometry(create(DEFAULT_GRID_SIZE, DEFAULT_GRID_SIZE)) { }
+    
+    static GridGeometry create(int width, int height);
+    
+    int getWidth() const {
+        return width;
+    }
+    
+    int getHeight() const {
+        return height;
+    }
+    
+    int getCellCount() const {
+        return width * height;
+    }
+    
+    std::pair<int, int> getRoot() const {
+        return {width / 2, height / 2};
+    }
+    
+    bool contains(const std::pair<int, int>& position) const {
+        return position.first >= 0 && position.first < width &&
+               position.second >= 0 && position.second < height;
+    }
+    
+    int toCell(const std::pair<int, int>& position) const {
+        return position.second * width + position.first;
+    }
+    
+    std::pair<int, int> toPosition(int cell) const {
+        return {cell % width, cell / width};
+    }
+    
+    // Gets the cell reached by moving in a direction, or -1 if
+    // the move would leave the grid
+    int getNeighbour(int cell, Direction direction) const {
+        if (direction >= Direction::INVALID)
+            return -1;
+        return neighbours[cell * NUM_DIRECTIONS + static_cast<int>(direction)];
+    }
+    
+    // Gets the center of a cell, normalized to [0, 1]
+    std::pair<double, double> getCenter(int cell) const {
+        return {centers[cell * 2], centers[cell * 2 + 1]};
+    }
+    
+    // Scale applied to node sprites so that larger grids still fit
+    double getNodeScale() const {
+        return static_cast<double>(DEFAULT_GRID_SIZE) / std::max(width, height);
+    }
+    
+  private:
+    GridGeometry(int width, int height, const int* neighbours,
+                 const double* centers, std::shared_ptr<const void> storage) :
+        width(width), height(height), neighbours(neighbours), centers(centers),
+        storage(storage) { }
+        
+    template <int W, int H>
+    static GridGeometry fromGrid() {
+        return GridGeometry(W, H, &Grid<W, H>::TABLES.neighbours[0][0],
+                            &Grid<W, H>::TABLES.centers[0][0], nullptr);
+    }
+    
+    int width;
+    int height;
+    const int* neighbours;
+    const double* centers;
+    
+    // Owns the tables of grids that were computed at runtime
+    std::shared_ptr<const void> storage;
+};
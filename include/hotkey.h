@@ -18,6 +18,7 @@
 #pragma once
 
 #include <thread>
+#include <string>
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -36,6 +37,15 @@ namespace HotKey {
     int keycode;
     int modifiers;
     bool die = false;
+    // Set by queryError while looking for the focused window's class
+    bool queryFailed = false;
+    
+    // Windows can be destroyed while they are being queried, which would
+    // otherwise end up in Xlib's default handler and exit
+    int queryError(Display*, XErrorEvent*) {
+        queryFailed = true;
+        return 0;
+    }
     
     void configureHotkey(int keysym, int mods,
                          std::function<void(Controller*)> callback,
@@ -69,6 +79,51 @@ namespace HotKey {
         hotkeyListener.detach();
     }
     
+    // Walks up from the focused window to the first one with a WM_CLASS
+    std::string findFocusedWindowClass() {
+        Window window;
+        int revert;
+        XGetInputFocus(dpy, &window, &revert);
+        
+        // Focus often sits on a child of the window that carries WM_CLASS
+        while (window != None && window != PointerRoot && window != root) {
+            XClassHint hint;
+            if (XGetClassHint(dpy, window, &hint)) {
+                std::string windowClass = hint.res_class ? hint.res_class : "";
+                if (hint.res_name)
+                    XFree(hint.res_name);
+                if (hint.res_class)
+                    XFree(hint.res_class);
+                return windowClass;
+            }
+            
+            Window rootWindow, parent;
+            Window* children;
+            unsigned int childCount;
+            if (!XQueryTree(dpy, window, &rootWindow, &parent, &children,
+                            &childCount))
+                break;
+            if (children)
+                XFree(children);
+            window = parent;
+        }
+        return "";
+    }
+    
+    // Gets the class part of the WM_CLASS of the focused window, or an
+    // empty string if there is none or a window went away while looking.
+    // Must be called from the listener thread, which owns the display
+    // connection.
+    std::string getFocusedWindowClass() {
+        queryFailed = false;
+        XErrorHandler previous = XSetErrorHandler(queryError);
+        std::string windowClass = findFocusedWindowClass();
+        // Errors arrive asynchronously, so collect them before restoring
+        XSync(dpy, False);
+        XSetErrorHandler(previous);
+        return queryFailed ? "" : windowClass;
+    }
+    
     void dispose() {
         die = true;
         XUngrabKey(dpy, keycode, modifiers, root);
@@ -14,21 +14,135 @@
 
 // You should have received a copy of the GNU General Public License along
 // with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
-
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <string>
+
 #include "util.h"
 #include "model.h"
+#include "action.h"
+#include "action_queue.h"
 
+// Something the user navigates with. Devices that handle Qt events emit
+// straight away on the GUI thread. Devices that need to poll or block do
+// so on a worker thread owned by this class, and queue what they emit for
+// the controller to collect. The controller drives every device through
+// its lifecycle, starting it when the overlay gains focus and pausing it
+// when the overlay loses it.
 class InputDevice {
   public:
-    InputDevice(std::function<void(std::string)> emitter) :
-        emitFunction(emitter) {
+    typedef std::function<void(const Action&)> emitter;
+    // Builds a device on first need, throwing if it can't
+    typedef std::function<std::shared_ptr<InputDevice>(emitter)> factory;
+    
+    enum class State : uint8_t {
+        STOPPED,
+        RUNNING,
+        PAUSED,
+        // The worker has nothing more to do
+        FINISHED,
+        // The worker threw, it won't be started again
+        FAILED
+    };
+    
+    struct Statistics {
+        uint64_t emitted;
+        // Dropped because the controller fell behind
+        uint64_t dropped;
+        // CPU time of the worker thread
+        double cpuMs;
+        // Wall time spent running
+        double runningMs;
         
-    }
+        double getEventRate() const {
+            return runningMs == 0.0 ? 0.0 : emitted * 1000.0 / runningMs;
+        }
+    };
+    
+    explicit InputDevice(emitter emitFunction,
+                         size_t outputCapacity = OUTPUT_CAPACITY);
+    // Devices with a worker must call stop() in their own destructor,
+    // since the worker calls into them
+    virtual ~InputDevice();
+    
+    InputDevice(const InputDevice&) = delete;
+    InputDevice& operator=(const InputDevice&) = delete;
+    
+    virtual std::string getName() const = 0;
     
     virtual void onKeyEvent(QKeyEvent* event) = 0;
     virtual void onFocusChange(const bool& hasFocus) = 0;
     
-    std::function<void(std::string)> emitFunction;
+    // Starts the worker the first time and resumes it after that. A
+    // device that follows focus is also started again once its worker
+    // finished or failed, such as when its camera was busy. Only ever
+    // one worker exists, however often this is called.
+    void start();
+    // Suspends the worker until the next start
+    void pause();
+    // Ends the worker and waits for it
+    void stop();
+    State getState() const;
+    
+    // Devices that keep running without focus, such as replays,
+    // aren't paused when the overlay loses focus
+    virtual bool followsFocus() const;
+    
+    // Called from the worker with every action it queues, as it is
+    // queued. Must be set before the device is started.
+    void setOutputHandler(std::function<void(const Action&)> handler);
+    // Takes the oldest queued action, only from the GUI thread
+    bool takeAction(Action& action);
+    // Only from the GUI thread, which takes the actions
+    Statistics getStatistics() const;
+    
+    static constexpr size_t OUTPUT_CAPACITY = 64;
+    
+    emitter emitFunction;
+    
+  protected:
+    // Whether the device needs a worker at all
+    virtual bool hasWorker() const;
+    
+    // Called on the worker each time it starts or resumes running, and
+    // each time it stops running. Resources held only while running,
+    // such as a camera, belong here.
+    virtual void onWorkerStart();
+    virtual void onWorkerPause();
+    
+    // One unit of work, called over and over while running. Returns false
+    // once there is nothing left to do.
+    virtual bool work();
+    
+    // Queues an action from the worker, dropping it and returning
+    // false if the queue is full
+    bool emit(const Action& action);
+    // Waits for room in the queue instead of dropping, for input that
+    // has to arrive whole. Returns false, having queued nothing, if
+    // the device stops running in the meantime.
+    bool emitWaiting(const Action& action);
+    
+    // Sleeps until a deadline, returning early and false if the
+    // device stops running in the meantime
+    bool waitUntil(std::chrono::steady_clock::time_point deadline);
+    
+  private:
+    void run();
+    
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::atomic<State> state;
+    std::thread worker;
+    
+    ActionQueue output;
+    std::function<void(const Action&)> outputHandler;
+    std::atomic<uint64_t> cpuTime;
+    std::atomic<uint64_t> runningTime;
 };
@@ -30,11 +30,30 @@
 #include "util.h"
 #include "model.h"
 
+// Maps keys to actions. The SEARCH key, or typing a character that isn't
+// bound to anything, starts a search instead. Every key after that edits
+// the query until the search is cancelled or run.
 class KeyboardInput : public InputDevice {
   public:
-    KeyboardInput(std::function<void(std::string)> emitter):
-        InputDevice(emitter) { }
-        
+    explicit KeyboardInput(emitter emitFunction);
+    
+    std::string getName() const;
+    
     void onKeyEvent(QKeyEvent* event);
     void onFocusChange(const bool& hasFocus);
+    
+  private:
+    void readKeys(const Json::Value& keys);
+    Action getAction(QKeyEvent* event) const;
+    bool onSearchKeyEvent(QKeyEvent* event, const Action& action);
+    void type(const std::string& text);
+    
+    // Bindings by Qt key code for keys named in util::keyToString,
+    // and by the character they type for every other key
+    std::unordered_map<int, Action> keyActions;
+    std::unordered_map<uint32_t, Action> characterActions;
+    
+    bool searching;
+    // Characters typed into the query, which the controller keeps
+    size_t queryLength;
 };
@@ -0,0 +1,55 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#pragma once
+
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+#include "command_registry.h"
+
+// Keeps the same application from being launched twice in a row. A
+// velocity gesture, a blink or a repeating key can reach the same leaf
+// again before the overlay hides, and each launch of a heavy application
+// costs seconds. A launch counts as in flight for a window after it was
+// let through, and launching the same command again within it is refused.
+class LaunchGate {
+  public:
+    typedef std::chrono::steady_clock clock;
+    
+    struct Statistics {
+        uint64_t admitted;
+        uint64_t suppressed;
+    };
+    
+    // A zero window lets every launch through
+    explicit LaunchGate(std::chrono::milliseconds window = WINDOW);
+    
+    // Whether a command may be launched now, recording it as in flight if so
+    bool admit(command_handle command, clock::time_point now = clock::now());
+    
+    Statistics getStatistics() const;
+    
+    static constexpr std::chrono::milliseconds WINDOW =
+        std::chrono::milliseconds(1000);
+        
+  private:
+    std::chrono::milliseconds window;
+    // When each command in flight was launched
+    std::unordered_map<command_handle, clock::time_point> inFlight;
+    Statistics statistics;
+};
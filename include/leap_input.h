@@ -23,25 +23,25 @@
 #include "config.h"
 
 #include <stdexcept>
+#include <cmath>
 
 #include "Leap.h"
 
 class LeapListener : public Leap::Listener {
   public:
-    LeapListener(std::function<void(std::string)> emitter) :
+    LeapListener(InputDevice::emitter emitter) :
         emitFunction(emitter),
         focus(false),
         hadHand(false),
         hadRegainedFocus(false),
-        lastPosition(0, 0) {};
+        lastPosition(0, 0),
+        pinchAction(Action::fromString(
+                        (*(Config::root))["poses"]["pinch"].asString())) {};
         
     virtual void onConnect(const Leap::Controller&);
     virtual void onDisconnect(const Leap::Controller&);
     virtual void onFrame(const Leap::Controller&);
 
-    const std::string PINCH = "pinch";
-    const std::string NOTHING = "nothing";
-    
     bool focus;
     uint64_t delayTimestamp;
     uint64_t actionTimestamp;
@@ -50,41 +50,28 @@ class LeapListener : public Leap::Listener {
     Leap::Vector relativeCenter;
     std::pair<int, int> lastPosition;
   private:
-  
-    inline bool checkEpsilon(const float& angle,
-                             const float& desired,
-                             const float& epsilon = 22.5) {
-        if ((desired < 0) || (desired >= 360))
-            throw std::out_of_range("Desired angle out of range " +
-                                    std::to_string(desired));
-                                    
-        float lowerBound = desired - epsilon;
-        float upperBound = desired + epsilon;
-        bool reverse = false;
-        
-        if (lowerBound < 0) {
-            lowerBound += 360;
-            reverse = true;
-        }
-        if (reverse)
-            return (angle < upperBound || angle > lowerBound);
-        else
-            return (angle > lowerBound && angle < upperBound);
-    }
+    // Action the configured pose stands for
+    Action pinchAction;
+    
+    // Direction of the 45 degree sector an angle falls in, counting
+    // counterclockwise from the right with y pointing up
+    Direction getAngleDirection(float angle) const;
     
     void handleHandVelocity(const Leap::Hand& hand);
     void handleHandPosition(const Leap::Hand& hand);
-    std::string getPose(const Leap::Hand& hand);
     
-    std::function<void(std::string)> emitFunction;
+    // Gets the action of the pose the hand is making, if any
+    Action getPose(const Leap::Hand& hand);
+    
+    InputDevice::emitter emitFunction;
 };
 
 class LeapInput : public InputDevice {
   public:
-    LeapInput(std::function<void(std::string)> emitter):
-        InputDevice(emitter),
+    LeapInput(emitter emitFunction):
+        InputDevice(emitFunction),
         controller(),
-        listener(emitter) {
+        listener(emitFunction) {
         controller.addListener(listener);
     }
     
@@ -92,6 +79,11 @@ class LeapInput : public InputDevice {
         controller.removeListener(listener);
     }
     
+    // Frames arrive on the SDK's own threads, so there is no worker
+    std::string getName() const {
+        return "Leap Motion";
+    }
+    
     virtual void onKeyEvent(QKeyEvent* event);
     void onFocusChange(const bool& hasFocus);
     
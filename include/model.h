@@ -24,68 +24,75 @@
 
 #include "util.h"
 #include "node.h"
+#include "grid.h"
+#include "command_registry.h"
 
+// Cursor over an immutable command tree. Models are cheap to copy since
+// copies share the tree, and navigating one never allocates.
 class Model {
   public:
-    typedef std::pair<util::Command, util::vec2i_ptr> command_position;
+    typedef std::pair<command_handle, util::vec2i_ptr> command_position;
+    typedef Tree<command_handle> command_tree;
+    
     // Populate node tree, allPaths is a vector of diffent paths,
     // current node will be root
-    Model(const std::vector<command_position> &allPaths) :
-        currentPosition(this->getRootPosition()) {
+    Model(const std::vector<command_position> &allPaths,
+          const GridGeometry& grid = GridGeometry()) :
+        grid(grid),
+        currentNode(0),
+        currentPosition(this->getRootPosition()),
+        compressed(false),
+        path(1, this->getRootPosition()) {
         if (allPaths.size() == 0)
             throw std::runtime_error("Path inputs are broken");
             
-        std::pair<int, int> root_node = this->getRootPosition();
-        std::shared_ptr<Node<util::Command>> root(new Node<util::Command>);
+        std::shared_ptr<command_tree> root(new command_tree);
+        root->reserve(allPaths.size() * 2);
         
         // For every path in the paths
         for (auto& path : allPaths) {
             // Make sure that the path is defined
             if (path.second->size() == 0)
                 continue;
-            std::pair<int, int> should_be_root = (*(path.second))[0];
-            
-            // The first node of every path should be the root
-            if (should_be_root != root_node)
-                throw std::runtime_error("Path does not begin with root node!");
-                
-            std::pair<int, int> lastPosition = root_node;
-            
-            std::shared_ptr<Node<util::Command>> curr = root;
-            // For every node in the path
-            for (auto& node : *(path.second)) {
-                std::pair<int, int> delta = node - lastPosition;
-                lastPosition = node;
-                if (delta == std::make_pair<int, int>(0, 0))
-                    continue;
-                else {
-                    // Get the move between the two nodes
-                    std::string direction = getDeltaDirection(delta);
-                    std::shared_ptr<Node<util::Command>> child;
-                    if (!curr->hasElement(direction))
-                        child = std::shared_ptr<Node<util::Command>>
-                                (new Node<util::Command>(curr));
-                    else
-                        child = curr->getElement(direction);
-                    curr->setElement(direction, child);
-                    curr = child;
-                }
-            }
-            curr->setData(path.first);
+            node_id curr = root->getRoot();
+            for (Direction direction : this->toMoves(path.first, *(path.second)))
+                curr = root->addChild(curr, direction);
+            root->setData(curr, path.first);
         }
-        this->currentNode = root;
+        root->computeLeafRanges();
+        this->tree = root;
+        this->currentNode = root->getRoot();
+        this->path.reserve(root->getMaxDepth() + 1);
     }
     
-    // Constructor to return subtree model
-    Model(std::shared_ptr<Node<util::Command>> root, std::pair<int, int> position) :
-        currentNode(root), currentPosition(position) {
-    }
+    // Navigate a tree that has already been built, such as one
+    // loaded from a compiled image
+    explicit Model(std::shared_ptr<const command_tree> tree,
+                   const GridGeometry& grid = GridGeometry());
+                   
+    // Gets the tree being navigated
+    const command_tree& getTree() const;
+    std::shared_ptr<const command_tree> getSharedTree() const;
+    
+    // Navigates another tree laid out on the same grid, starting
+    // over from its root
+    void setTree(std::shared_ptr<const command_tree> tree);
+    
+    // Gets the grid the paths are laid out on
+    const GridGeometry& getGrid() const;
+    
+    // Moves to the child in the given direction. Returns false
+    // and stays put if there is no such child
+    bool advance(Direction direction);
     
-    // Returns Model if valid, otherwise nulltpr
-    std::shared_ptr<Model> select(const std::string& direction) const;
+    // Goes one level up the tree. Returns false at the root
+    bool back();
     
-    // Goes one level up the tree
-    std::shared_ptr<Model> selectParent() const;
+    // In compressed mode, chains of nodes that only lead one way are
+    // followed automatically, so advance and back stop at the next branch
+    // point or leaf. The path still includes every node passed through.
+    void setCompressed(bool compressed);
+    bool isCompressed() const;
     
     // Gets the position of the root node
     std::pair<int, int> getRootPosition() const;
@@ -94,23 +101,60 @@ class Model {
     std::pair<int, int> getCurrentPosition() const;
     
     // If we have a leaf selected, gets
-    // the leaf
-    std::shared_ptr<util::Command> getCommand() const;
+    // the leaf, otherwise NO_COMMAND
+    command_handle getCommand() const;
     
     // Get list of commands that result from going in a
     // certain direction
-    std::shared_ptr<std::vector<util::Command>> getCommandsInDirection(
-                const std::string& direction) const;
+    util::Span<command_handle> getCommandsInDirection(Direction direction) const;
                 
+    // Get every command that can still be reached from here
+    util::Span<command_handle> getReachableCommands() const;
+    
     // Gets viable directions to move next
-    std::shared_ptr<std::vector<std::string>> getViableDirections() const;
+    DirectionSet getViableDirections() const;
+    
+    // Returns the path of nodes that have been selected,
+    // starting at the root
+    util::Span<std::pair<int, int>> getPath() const;
     
-    // Returns the path of nodes that have been selected
-    std::shared_ptr<util::vec2i> getPath() const;
+    // Adds a command, or replaces the one at the end of its path, without
+    // rebuilding the tree. Returns the nodes whose subtrees changed.
+    std::vector<node_id> insert(command_handle command,
+                                const util::vec2i& path);
+                                
+    // Removes the command that runs the given command line, pruning the
+    // branches left empty. Goes back to the root if the current node was
+    // pruned. Returns the nodes whose subtrees changed.
+    std::vector<node_id> remove(const std::string& command);
+    
+    // Gets the node that is currently selected
+    node_id getCurrentNode() const;
     
     // Resets the model to its default state
     void reset();
   private:
-    std::shared_ptr<Node<util::Command>> currentNode;
+    // Checks that a path starts at the root and stays on the grid,
+    // and converts it to the moves between its nodes
+    std::vector<Direction> toMoves(command_handle command,
+                                   const util::vec2i& path) const;
+                                   
+    // Copies the tree first if other models are navigating it too
+    command_tree& getMutableTree();
+    
+    // True if a node offers a single move and nothing to launch
+    bool isForced(node_id id) const;
+    
+    void step(Direction direction);
+    void stepBack();
+    
+    GridGeometry grid;
+    std::shared_ptr<const command_tree> tree;
+    node_id currentNode;
     std::pair<int, int> currentPosition;
+    bool compressed;
+    
+    // Positions from the root to the current node, kept up to date
+    // as we navigate
+    util::vec2i path;
 };
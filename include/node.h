@@ -18,191 +18,449 @@
 #pragma once
 
 #include <memory>
-#include <unordered_map>
 #include <algorithm>
 #include <vector>
-#include <cstdlib>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
 
 #include "util.h"
 
+// The eight moves that can be made from one grid cell to a neighbour
+enum class Direction : uint8_t {
+    RIGHT = 0,
+    UP_RIGHT,
+    UP,
+    UP_LEFT,
+    LEFT,
+    DOWN_LEFT,
+    DOWN,
+    DOWN_RIGHT,
+    INVALID
+};
+
+static constexpr int NUM_DIRECTIONS = 8;
+
+static constexpr const char* DIRECTION_NAMES[NUM_DIRECTIONS] = {
+    "r_", "ur", "u_", "ul", "l_", "dl", "d_", "dr"
+};
+
+// Grid deltas indexed by Direction, y grows downwards
+static constexpr int DIRECTION_DELTAS[NUM_DIRECTIONS][2] = {
+    {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}, {0, 1}, {1, 1}
+};
+
+// The inverse, indexed by [dx + 1][dy + 1]
+static constexpr Direction DELTA_DIRECTIONS[3][3] = {
+    {Direction::UP_LEFT, Direction::LEFT, Direction::DOWN_LEFT},
+    {Direction::UP, Direction::INVALID, Direction::DOWN},
+    {Direction::UP_RIGHT, Direction::RIGHT, Direction::DOWN_RIGHT}
+};
+
+typedef uint32_t node_id;
+static constexpr node_id NO_NODE = 0xFFFFFFFF;
+
+// A single node in the arena. Children are addressed by Direction
+// and refer to other nodes by their index in the arena. The data of
+// every node in the subtree occupies [leafBegin, leafEnd) of the data store.
+// direction is the move that leads from the parent to this node.
+struct Node {
+    Node() : parent(NO_NODE), data(NO_NODE), leafBegin(0), leafEnd(0),
+        childMask(0), direction(Direction::INVALID) {
+        std::fill(std::begin(children), std::end(children), NO_NODE);
+    }
+    
+    node_id children[NUM_DIRECTIONS];
+    node_id parent;
+    node_id data;
+    uint32_t leafBegin;
+    uint32_t leafEnd;
+    uint8_t childMask;
+    Direction direction;
+};
+
+// Set of directions backed by a child bitmask, iterable without allocating
+class DirectionSet {
+  public:
+    class iterator {
+      public:
+        explicit iterator(uint8_t mask) : mask(mask) { }
+        
+        Direction operator*() const {
+            return static_cast<Direction>(__builtin_ctz(mask));
+        }
+        
+        iterator& operator++() {
+            mask &= mask - 1;
+            return *this;
+        }
+        
+        bool operator==(const iterator& other) const {
+            return mask == other.mask;
+        }
+        
+        bool operator!=(const iterator& other) const {
+            return mask != other.mask;
+        }
+      private:
+        uint8_t mask;
+    };
+    
+    explicit DirectionSet(uint8_t mask = 0) : mask(mask) { }
+    
+    iterator begin() const {
+        return iterator(mask);
+    }
+    
+    iterator end() const {
+        return iterator(0);
+    }
+    
+    bool contains(Direction direction) const {
+        return direction < Direction::INVALID &&
+               (mask & (1 << static_cast<int>(direction)));
+    }
+    
+    int size() const {
+        return __builtin_popcount(mask);
+    }
+    
+    bool empty() const {
+        return mask == 0;
+    }
+    
+  private:
+    uint8_t mask;
+};
+
+// Direction trie whose nodes all live in one contiguous arena. Node IDs are
+// indices into the arena and remain stable for the lifetime of the tree.
+// The arena is either owned by the tree or read in place from memory owned
+// by someone else, such as a mapped image; the latter is copied on write.
 template <class T>
-class Node {
+class Tree {
   public:
-    typedef std::shared_ptr<Node <T>> node_ptr;
-    typedef std::vector<std::shared_ptr<Node <T>>> child_vector;
-    typedef std::unordered_map<std::string, child_vector> collapsed_children;
+    Tree() : nodes(1), data(), freeNodes(), maxDepth(0), mapping() {
+        syncView();
+    }
     
-    Node() : Node(nullptr) { }
+    // Wraps an arena that was already laid out by computeLeafRanges, with
+    // data in leaf order. mapping keeps the memory behind mappedNodes alive.
+    Tree(const Node* mappedNodes, size_t count, std::vector<T> data,
+         uint32_t maxDepth, std::shared_ptr<const void> mapping) :
+        nodes(), data(std::move(data)), freeNodes(), maxDepth(maxDepth),
+        mapping(mapping),
+        view(mappedNodes), count(count) {
+    }
     
-    Node(std::shared_ptr<Node<T>> parent) : Node(nullptr, parent) { }
+    Tree(const Tree& other) :
+        nodes(other.nodes), data(other.data), freeNodes(other.freeNodes),
+        maxDepth(other.maxDepth), mapping(other.mapping), view(other.view),
+        count(other.count) {
+        if (mapping == nullptr)
+            syncView();
+    }
     
-    Node(std::shared_ptr<T> data_ptr, node_ptr parent) :
-        children(),
-        parent(parent),
-        data(data_ptr),
-        ID((static_cast<long>(rand()) << (sizeof(int) * 8)) |
-           rand()) {
+    Tree& operator=(const Tree& other) {
+        nodes = other.nodes;
+        data = other.data;
+        freeNodes = other.freeNodes;
+        maxDepth = other.maxDepth;
+        mapping = other.mapping;
+        view = other.view;
+        count = other.count;
+        if (mapping == nullptr)
+            syncView();
+        return *this;
     }
     
-    bool isLeaf() {
-        if (children.count("r_") || children.count("ur") || children.count("u_") ||
-                children.count("ul") || children.count("l_") ||
-                children.count("ld") || children.count("d_") || children.count("dr"))
-            return false;
-        else
-            return true;
+    Tree(Tree&&) = default;
+    Tree& operator=(Tree&&) = default;
+    
+    node_id getRoot() const {
+        return 0;
     }
     
-    bool isCommand() const {
-        return false;
+    size_t size() const {
+        return count;
     }
     
-    std::shared_ptr<std::vector<std::pair<std::string, node_ptr>>> unpack() const {
-        std::vector<std::pair<std::string, node_ptr>> unpackedChildren;
-        for (auto child : this->children) {
-            unpackedChildren.push_back(std::make_pair(child.first, child.second));
-        }
-        return std::make_shared<std::vector<std::pair<std::string, node_ptr>>>
-               (unpackedChildren);
+    void reserve(size_t numNodes) {
+        makeMutable();
+        nodes.reserve(numNodes);
+        syncView();
+    }
+    
+    // True if the nodes are read in place from external memory
+    bool isMapped() const {
+        return mapping != nullptr;
+    }
+    
+    // False for IDs outside the arena and for nodes that were pruned
+    bool contains(node_id id) const {
+        return id < count && (id == getRoot() || view[id].parent != NO_NODE);
+    }
+    
+    const Node& getNode(node_id id) const {
+        return view[id];
+    }
+    
+    bool isLeaf(node_id id) const {
+        return view[id].childMask == 0;
+    }
+    
+    DirectionSet getChildren(node_id id) const {
+        return DirectionSet(view[id].childMask);
+    }
+    
+    bool hasChild(node_id id, Direction direction) const {
+        return direction < Direction::INVALID &&
+               (view[id].childMask & (1 << static_cast<int>(direction)));
+    }
+    
+    node_id getChild(node_id id, Direction direction) const {
+        if (direction >= Direction::INVALID)
+            return NO_NODE;
+        return view[id].children[static_cast<int>(direction)];
     }
     
-    std::vector<node_ptr> getChildrenList() const {
-        std::vector<node_ptr> childList;
-        for (auto child : children)
-            childList.push_back(child.second);
-        return childList;
+    node_id getParent(node_id id) const {
+        return view[id].parent;
     }
     
-    node_ptr getParent() const {
-        return parent;
+    // Gets the move that leads from the parent of a node to the node
+    Direction getIncomingDirection(node_id id) const {
+        return view[id].direction;
     }
     
-    void setData(T data) {
-        this->data = std::make_shared<T>(data);
+    // Returns the child in the given direction, creating it if needed
+    node_id addChild(node_id id, Direction direction) {
+        if (direction >= Direction::INVALID)
+            throw std::runtime_error("Cannot add a child in an invalid direction");
+        node_id existing = getChild(id, direction);
+        if (existing != NO_NODE)
+            return existing;
+            
+        makeMutable();
+        node_id child;
+        if (!freeNodes.empty()) {
+            child = freeNodes.back();
+            freeNodes.pop_back();
+            nodes[child] = Node();
+        } else {
+            child = static_cast<node_id>(nodes.size());
+            nodes.push_back(Node());
+        }
+        nodes[child].parent = id;
+        nodes[child].direction = direction;
+        nodes[id].children[static_cast<int>(direction)] = child;
+        nodes[id].childMask |= 1 << static_cast<int>(direction);
+        syncView();
+        return child;
     }
     
-    node_ptr getElement(const std::string& name) {
-        return children[name];
+    void setData(node_id id, const T& value) {
+        makeMutable();
+        if (nodes[id].data == NO_NODE) {
+            nodes[id].data = static_cast<node_id>(data.size());
+            data.push_back(value);
+        } else
+            data[nodes[id].data] = value;
     }
     
-    void setElement(const std::string& element,
-                    const std::shared_ptr<Node<T>>& value) {
-        children[element] = value;
+    // Returns nullptr if the node has no data attached
+    const T* getData(node_id id) const {
+        if (view[id].data == NO_NODE)
+            return nullptr;
+        return &data[view[id].data];
     }
     
-    void setElement(const std::string& element,
-                    const Node<T>& value) {
-        children[element] = std::make_shared<Node<T>>(value);
+    // Gets the data of every node in the subtree rooted at id, in DFS order.
+    // Only valid after computeLeafRanges has been called.
+    util::Span<T> getLeaves(node_id id) const {
+        if (data.empty())
+            return util::Span<T>();
+        return util::Span<T>(data.data() + view[id].leafBegin,
+                             data.data() + view[id].leafEnd);
     }
     
-    bool hasElement(const std::string& element) {
-        return this->children.count(element) > 0;
+    // Length of the longest path from the root, as of the last call to
+    // computeLeafRanges. Removing nodes since then may leave it too large.
+    uint32_t getMaxDepth() const {
+        return maxDepth;
     }
     
-    bool operator==(const Node<T>& other) const {
-        return ID == other.ID;
+    // Reorders the data store so that every subtree owns a contiguous
+    // range of it. Must be called again after the tree is modified.
+    void computeLeafRanges() {
+        makeMutable();
+        std::vector<T> ordered;
+        ordered.reserve(data.size());
+        maxDepth = 0;
+        assignLeafRange(getRoot(), 0, ordered);
+        data.swap(ordered);
     }
     
-    bool operator!=(const Node<T>& other) const {
-        return !(*this == other);
+    // Attaches a value at the end of the given moves, creating nodes as
+    // needed, without recomputing the leaf ranges from scratch. The ranges
+    // must already be up to date. Returns the nodes from the root down to
+    // the value, which are the only subtrees whose contents changed.
+    std::vector<node_id> insert(const std::vector<Direction>& moves,
+                                const T& value) {
+        makeMutable();
+        std::vector<node_id> affected(1, getRoot());
+        affected.reserve(moves.size() + 1);
+        
+        // Follow the existing nodes as far as they go
+        size_t existing = 0;
+        for (; existing < moves.size(); existing++) {
+            node_id child = getChild(affected.back(), moves[existing]);
+            if (child == NO_NODE)
+                break;
+            affected.push_back(child);
+        }
+        
+        // A new branch starts right after the data of its parent and
+        // everything under its siblings in earlier directions
+        uint32_t position;
+        if (existing < moves.size()) {
+            const Node& parent = nodes[affected.back()];
+            position = parent.leafBegin + (parent.data != NO_NODE);
+            for (int i = 0; i < static_cast<int>(moves[existing]); i++)
+                if (parent.children[i] != NO_NODE)
+                    position += nodes[parent.children[i]].leafEnd -
+                                nodes[parent.children[i]].leafBegin;
+            for (; existing < moves.size(); existing++) {
+                node_id child = addChild(affected.back(), moves[existing]);
+                nodes[child].leafBegin = nodes[child].leafEnd = position;
+                affected.push_back(child);
+            }
+        } else if (nodes[affected.back()].data != NO_NODE) {
+            data[nodes[affected.back()].data] = value;
+            return affected;
+        } else
+            position = nodes[affected.back()].leafBegin;
+            
+        // Everything from the insertion point on moves up by one, except
+        // the new value's ancestors, whose ranges grow to cover it
+        data.insert(data.begin() + position, value);
+        for (Node& node : nodes) {
+            if (node.leafBegin >= position) {
+                node.leafBegin++;
+                node.leafEnd++;
+            }
+            if (node.data != NO_NODE && node.data >= position)
+                node.data++;
+        }
+        for (node_id id : affected) {
+            if (nodes[id].leafBegin > position)
+                nodes[id].leafBegin--;
+            else
+                nodes[id].leafEnd++;
+        }
+        nodes[affected.back()].data = position;
+        maxDepth = std::max(maxDepth, static_cast<uint32_t>(moves.size()));
+        return affected;
     }
     
-    // Get map which contains vectors of all the children of the respective node, flattened into a list
-    std::shared_ptr<collapsed_children> getCollapsedPossibilities() const {
-        std::shared_ptr<collapsed_children> collapsedRules(new collapsed_children);
-        auto unpackedChildren = * (this->unpack());
-        for (auto map : unpackedChildren) {
-            std::vector<node_ptr> collapsedChildrenVec;
-            if (map.second != nullptr)
-                collapsePossibilities(map.second, collapsedChildrenVec);
-            (*collapsedRules)[map.first] = std::move(collapsedChildrenVec);
+    // Detaches the value of a node and prunes the branches left empty,
+    // keeping the leaf ranges up to date. Pruned IDs are reused by later
+    // insertions. Returns the pruned nodes followed by their remaining
+    // ancestors up to the root, or nothing if the node had no value.
+    std::vector<node_id> remove(node_id id) {
+        std::vector<node_id> affected;
+        if (!contains(id) || view[id].data == NO_NODE)
+            return affected;
+        makeMutable();
+        
+        const uint32_t position = nodes[id].data;
+        data.erase(data.begin() + position);
+        nodes[id].data = NO_NODE;
+        for (Node& node : nodes) {
+            if (node.leafBegin > position)
+                node.leafBegin--;
+            if (node.leafEnd > position)
+                node.leafEnd--;
+            if (node.data != NO_NODE && node.data > position)
+                node.data--;
         }
-        return collapsedRules;
+        
+        // Prune upwards until a node still leads somewhere
+        while (id != getRoot() && nodes[id].childMask == 0 &&
+                nodes[id].data == NO_NODE) {
+            node_id parent = nodes[id].parent;
+            int direction = static_cast<int>(nodes[id].direction);
+            nodes[parent].children[direction] = NO_NODE;
+            nodes[parent].childMask &= ~(1 << direction);
+            nodes[id] = Node();
+            freeNodes.push_back(id);
+            affected.push_back(id);
+            id = parent;
+        }
+        for (; id != NO_NODE; id = nodes[id].parent)
+            affected.push_back(id);
+        return affected;
     }
     
-    std::unordered_map<std::string, node_ptr> children;
-    std::shared_ptr<Node<T>> parent;
-    std::shared_ptr<T> data;
-    long ID;
   private:
-    void collapsePossibilities(const node_ptr& node,
-                               std::vector<node_ptr>& output) const {
-        output.clear();
-        if (node->isCommand()) {
-            output.push_back(node);
+    void syncView() {
+        view = nodes.data();
+        count = nodes.size();
+    }
+    
+    // Copies mapped nodes into the tree's own arena before modifying them
+    void makeMutable() {
+        if (mapping == nullptr)
             return;
+        nodes.assign(view, view + count);
+        mapping.reset();
+        syncView();
+    }
+    
+    void assignLeafRange(node_id id, uint32_t depth, std::vector<T>& ordered) {
+        maxDepth = std::max(maxDepth, depth);
+        nodes[id].leafBegin = static_cast<uint32_t>(ordered.size());
+        if (nodes[id].data != NO_NODE) {
+            ordered.push_back(std::move(data[nodes[id].data]));
+            nodes[id].data = nodes[id].leafBegin;
         }
-        for (auto& child : node->getChildrenList()) {
-            if (!((*child).isCommand())) {
-                std::vector<node_ptr> additionalOutput;
-                collapsePossibilities(child, additionalOutput);
-                std::copy(additionalOutput.begin(), additionalOutput.end(),
-                          std::back_inserter(output));
-            } else
-                output.push_back(child);
-        }
+        for (int i = 0; i < NUM_DIRECTIONS; i++)
+            if (nodes[id].children[i] != NO_NODE)
+                assignLeafRange(nodes[id].children[i], depth + 1, ordered);
+        nodes[id].leafEnd = static_cast<uint32_t>(ordered.size());
     }
+    
+    std::vector<Node> nodes;
+    std::vector<T> data;
+    std::vector<node_id> freeNodes;
+    uint32_t maxDepth;
+    std::shared_ptr<const void> mapping;
+    
+    const Node* view;
+    size_t count;
 };
 
-template <>
-inline bool Node<util::Command>::isCommand() const {
-    return this->data != nullptr;
+inline std::string directionToString(Direction direction) {
+    if (direction >= Direction::INVALID)
+        return "Invalid direction!";
+    return DIRECTION_NAMES[static_cast<int>(direction)];
 }
 
-template <class T>
-inline std::ostream& operator<<(std::ostream& strm, Node<T> const& node) {
-    if (node.data != nullptr)
-        strm << "Data: " << *(node.data);
-    else
-        strm << "No data found";
-    auto unpackedChildren = * node.unpack();
-    for (auto child : unpackedChildren) {
-        if (child.second != nullptr) {
-            strm << "\t" << child.first << ": " << *(child.second);
-            strm << "\n";
-        }
-    }
-    return strm;
+inline Direction directionFromString(const std::string& name) {
+    for (int i = 0; i < NUM_DIRECTIONS; i++)
+        if (name == DIRECTION_NAMES[i])
+            return static_cast<Direction>(i);
+    return Direction::INVALID;
 }
 
-inline std::string getDeltaDirection(const std::pair<int, int>& delta) {
-    if (delta == std::make_pair(1, 0))
-        return "r_";
-    else if (delta == std::make_pair(1, -1))
-        return "ur";
-    else if (delta == std::make_pair(1, 1))
-        return "dr";
-    else if (delta == std::make_pair(0, -1))
-        return "u_";
-    else if (delta == std::make_pair(0, 1))
-        return "d_";
-    else if (delta == std::make_pair(-1, 0))
-        return "l_";
-    else if (delta == std::make_pair(-1, -1))
-        return "ul";
-    else if (delta == std::make_pair(-1, 1))
-        return "dl";
-    else
-        return "Invalid delta!";
+inline constexpr Direction getDeltaDirection(const std::pair<int, int>& delta) {
+    return delta.first < -1 || delta.first > 1 || delta.second < -1 ||
+           delta.second > 1 ? Direction::INVALID :
+           DELTA_DIRECTIONS[delta.first + 1][delta.second + 1];
 }
 
-inline std::pair<int, int> getDelta(const std::string& direction) {
-    if (direction == "r_")
-        return std::make_pair(1, 0);
-    else if (direction == "ur")
-        return std::make_pair(1, -1);
-    else if (direction == "dr")
-        return std::make_pair(1, 1);
-    else if (direction == "u_")
-        return std::make_pair(0, -1);
-    else if (direction == "d_")
-        return std::make_pair(0, 1);
-    else if (direction == "l_")
-        return std::make_pair(-1, 0);
-    else if (direction == "ul")
-        return std::make_pair(-1, -1);
-    else if (direction == "dl")
-        return std::make_pair(-1, 1);
-    else
-        return std::make_pair(0, 0);
-}
\ No newline at end of file
+inline constexpr std::pair<int, int> getDelta(Direction direction) {
+    return direction >= Direction::INVALID ? std::make_pair(0, 0) :
+           std::make_pair(DIRECTION_DELTAS[static_cast<int>(direction)][0],
+                          DIRECTION_DELTAS[static_cast<int>(direction)][1]);
+}
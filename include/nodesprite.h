@@ -19,44 +19,80 @@
 
 #include <cmath>
 #include <algorithm>
+#include <list>
 #include <vector>
+#include <cstdint>
 
 #include <QImage>
 #include <QColor>
 #include <QIcon>
 #include <QPainter>
+#include <QRect>
 
 #include "util.h"
 #include "config.h"
 
 class NodeSprite {
   public:
+    // How often rendering reused a node's composed mosaic
+    struct CacheStatistics {
+        uint64_t hits;
+        uint64_t misses;
+    };
+    
     NodeSprite(const std::pair<int, int>& position,
-               const util::WindowProperties& winprops);
+               const util::WindowProperties& winprops, double scale = 1.0);
     NodeSprite(const NodeSprite& nodesprite) = default;
     
+    // Moves and resizes the sprite, such as after the window resized
+    void place(const std::pair<int, int>& position,
+               const util::WindowProperties& winprops, double scale = 1.0);
+               
     static void loadAssets();
     static void destroyAssets();
     static std::pair<double, double> getIdealSize(const util::WindowProperties&
-            winprops);
+            winprops, double scale = 1.0);
+    static CacheStatistics getCacheStatistics();
             
     void select();
     void unselect();
     void highlight();
     
-    void setIcons(const std::vector<std::shared_ptr<QIcon>>& icons);
+    void setIcons(const std::vector<const QIcon*>& icons);
+    // Composes the mosaic the sprite will need once it shows these icons
+    // unselected, without showing them yet
+    void warm(const std::vector<const QIcon*>& icons);
     
     void render(const util::WindowProperties& winprops, QPainter& painter);
     
+    // Area that render paints, outline included
+    QRect getBounds() const;
+    
     static constexpr double NODE_WIDTH = 0.1;
     static constexpr double NODE_HEIGHT = 0.1;
     
     static constexpr int NUM_FRAMES = 4;
+    // Composed mosaics kept per sprite, enough for going back and forth
+    // between a few levels
+    static constexpr size_t MOSAIC_CACHE_SIZE = 8;
     
     std::pair<int, int> _position;
   private:
-    void drawOverlay(QPainter& painter);
-    void drawIcons(QPainter& painter);
+    void drawOverlay(QPainter& painter, const QColor& tint) const;
+    void drawIcons(QPainter& painter,
+                   const std::vector<const QIcon*>& icons) const;
+    // Works out where the sprite is drawn, which only changes when it
+    // is placed
+    void layout();
+    // Where each of that many icons goes
+    std::vector<QRect> getMosaic(size_t count) const;
+    void setTint(const QColor& tint);
+    // Rasterizes a tint and icons into a single pixmap
+    QPixmap compose(const std::vector<const QIcon*>& icons,
+                    const QColor& tint) const;
+    // The composed pixmap for a tint and icons, from the cache if it can
+    const QPixmap& getComposed(const std::vector<const QIcon*>& icons,
+                               const QColor& tint);
     
     static std::unique_ptr<QPixmap> unselected;
     QPixmap current;
@@ -64,8 +100,23 @@ class NodeSprite {
     
     static bool initialized;
     
-    std::vector<std::shared_ptr<QIcon>> icons;
+    // Owned by the CommandRegistry
+    std::vector<const QIcon*> icons;
     
     int frame;
     QColor tint;
+    bool animated;
+    
+    QRectF ellipse;
+    QRect bounds;
+    
+    // A tint and icons as composed for the current size
+    struct Composed {
+        std::vector<const QIcon*> icons;
+        QColor tint;
+        QPixmap pixmap;
+    };
+    // Most recently rendered first, dropped once the size changes
+    std::list<Composed> composed;
+    static CacheStatistics cacheStatistics;
 };
\ No newline at end of file
@@ -0,0 +1,41 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "util.h"
+#include "node.h"
+#include "grid.h"
+#include "model.h"
+
+// Gives every application without a hand-assigned path a valid path through
+// the grid. New leaves are handed out shallowest first to the most
+// frequently launched applications, and the tree only grows deeper when it
+// runs out of room, much like building a Huffman code over the eight moves.
+class PathAssigner {
+  public:
+    typedef std::function<double(command_handle)> frequency_function;
+    
+    // Assigns paths in place, never touching commands that already have
+    // one. Returns the number of commands that were given a path.
+    static size_t assign(std::vector<Model::command_position>& commands,
+                         const GridGeometry& grid,
+                         const frequency_function& frequency);
+};
@@ -0,0 +1,133 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "util.h"
+#include "model.h"
+
+// Learns which commands get launched and, while the user is still
+// navigating, warms whatever the likeliest destinations will need:
+// the view one move closer to them and the page cache for their binaries.
+class Predictor {
+  public:
+    struct Statistics {
+        // Launches that happened while a prediction was outstanding
+        uint64_t predictions;
+        // Of those, launches of a command that had been predicted
+        uint64_t hits;
+        uint64_t misses;
+        // Binaries read ahead into the page cache
+        uint64_t binariesWarmed;
+        // Views handed to the warmer ahead of time
+        uint64_t viewsWarmed;
+        
+        double getHitRate() const {
+            return predictions == 0 ? 0.0 : (double) hits / predictions;
+        }
+    };
+    
+    // Without warming there is no worker thread, which is all that is
+    // needed to read scores
+    explicit Predictor(bool warming = true);
+    
+    // Called on the GUI thread with where the likeliest launch is one
+    // move from now, to prepare drawing it
+    typedef std::function<void(const Model& next)> view_warmer;
+    ~Predictor();
+    
+    Predictor(const Predictor&) = delete;
+    Predictor& operator=(const Predictor&) = delete;
+    
+    // Reads and writes launch history
+    void load(const std::string& filename);
+    void save(const std::string& filename) const;
+    // Writes a snapshot of the history on the worker, so launching never
+    // waits on the disk. Only the latest snapshot is written, at the
+    // latest when the predictor is destroyed.
+    void saveLater(const std::string& filename);
+    
+    // Records that a command was launched, scoring the
+    // prediction that was outstanding at the time
+    void recordLaunch(command_handle command);
+    
+    // Ranks the commands reachable from the current node and warms the
+    // likeliest ones. Does nothing while too many commands are reachable.
+    void predict(const Model& model);
+    
+    // Forgets the outstanding prediction, e.g. when the overlay closes
+    void cancel();
+    
+    // Frequency score of a command, decayed by how long ago it was launched
+    double getScore(const std::string& command) const;
+    
+    void setViewWarmer(view_warmer warmer);
+    
+    Statistics getStatistics() const;
+    
+    // Only predict once the reachable commands fit in a handful
+    static constexpr size_t MAX_CANDIDATES = 16;
+    static constexpr size_t MAX_PREDICTIONS = 3;
+    
+    // Launch scores halve every week
+    static constexpr double HALF_LIFE_MS = 7 * 24 * 60 * 60 * 1000.0;
+    
+  private:
+    struct Entry {
+        double score;
+        uint64_t timestamp;
+    };
+    typedef std::unordered_map<std::string, Entry> history_map;
+    
+    static void writeHistory(const std::string& filename,
+                             const history_map& history);
+    double decay(const Entry& entry, uint64_t now) const;
+    void warmView(const Model& model, command_handle likeliest);
+    void warmBinary(const std::string& command);
+    void warmBinaries();
+    
+    history_map history;
+    std::vector<command_handle> outstanding;
+    view_warmer warmer;
+    
+    uint64_t predictions;
+    uint64_t hits;
+    std::atomic<uint64_t> binariesWarmed;
+    uint64_t viewsWarmed;
+    
+    // Binaries are read ahead and history written on a worker
+    // thread so that navigation never waits on the disk
+    std::thread worker;
+    mutable std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<std::string> queue;
+    std::unordered_map<std::string, uint64_t> recentlyWarmed;
+    std::unique_ptr<history_map> pendingHistory;
+    std::string pendingFile;
+    bool stopping;
+};
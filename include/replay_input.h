@@ -0,0 +1,66 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+#include "input_device.h"
+#include "action_recorder.h"
+#include "model.h"
+
+// Feeds a recording back as if it came from a device, from its worker.
+// Recordings can also be generated, to stress the controller with more
+// input than any device produces.
+class ReplayInput : public InputDevice {
+  public:
+    // Speed multiplies the recorded pace, or replays as fast as
+    // possible if zero. Called on the worker when done.
+    ReplayInput(emitter emitFunction, std::vector<ActionRecorder::Entry> entries,
+                double speed = 1.0, std::function<void()> onFinished = nullptr);
+    ~ReplayInput();
+    
+    std::string getName() const;
+    
+    void onKeyEvent(QKeyEvent* event);
+    void onFocusChange(const bool& hasFocus);
+    
+    // Keeps going while the overlay is hidden
+    bool followsFocus() const;
+    
+    // Random navigation of the model's tree at the given number of actions
+    // per second, or all at once if zero. Moves never reach a leaf, so
+    // replaying it doesn't launch anything while in step with the model.
+    static std::vector<ActionRecorder::Entry> generate(const Model& model,
+            size_t count, double rate, unsigned seed = 0);
+            
+  protected:
+    bool hasWorker() const;
+    void onWorkerStart();
+    bool work();
+    
+  private:
+    std::vector<ActionRecorder::Entry> entries;
+    double speed;
+    std::function<void()> onFinished;
+    
+    // Only used from the worker
+    size_t next;
+    std::chrono::steady_clock::time_point origin;
+};
@@ -19,6 +19,8 @@
 
 #include <unordered_map>
 #include <set>
+#include <vector>
+#include <chrono>
 
 #include <QApplication>
 #include <QDesktopWidget>
@@ -26,10 +28,16 @@
 #include <QEvent>
 #include <QWidget>
 #include <QPainter>
+#include <QPainterPath>
+#include <QPen>
+#include <QResizeEvent>
+#include <QPixmap>
+#include <QRegion>
 #include <QTime>
 
 #include "util.h"
 #include "config.h"
+#include "grid.h"
 #include "nodesprite.h"
 
 class UIOverlay : public QWidget {
@@ -40,7 +48,15 @@ class UIOverlay : public QWidget {
     typedef std::pair<std::pair<int, int>,
             std::pair<int, int>> coord_pair;
             
-    UIOverlay(QWidget* parent = 0);
+    // Time from a request to show the overlay to its first painted frame
+    struct ShowStatistics {
+        uint64_t shown;
+        double meanLatencyMs;
+        double maxLatencyMs;
+        double lastLatencyMs;
+    };
+            
+    UIOverlay(const GridGeometry& grid, QWidget* parent = 0);
     UIOverlay(UIOverlay&&) =
         default;                                                                            // Move constructor
     ~UIOverlay();                                                                              // Destructor
@@ -52,52 +68,124 @@ class UIOverlay : public QWidget {
     void setController(std::function<void(QKeyEvent*)> controller);
     void setFocusHandler(std::function<void(const bool& hasFocus)> handler);
     
+    // Calls the handler on the GUI thread once its event loop gets to it.
+    // wake can be called from any thread.
+    void setWakeHandler(std::function<void()> handler);
+    void wake();
+    
+    // Called on the GUI thread once the first frame of a show is painted
+    void setShownHandler(std::function<void()> handler);
+    
+    // Paints the first frame, and keeps animated sprites moving
+    // for as long as the overlay is visible
     void start();
     static void terminate();
     
+    // Creates the native window and renders the current frame into the
+    // backing store while hidden, so showing it only has to copy it
+    void prewarm();
+    
+    // Shows and focuses the overlay, timing its first frame from
+    // when it was requested unless that is the epoch
+    void present(std::chrono::steady_clock::time_point requested);
+    ShowStatistics getShowStatistics() const;
+    
     void selectNode(const std::pair<int, int>& position);
     void deselectNode(const std::pair<int, int>& position);
     void highlightNode(const std::pair<int, int>& position);
     void drawPath(const std::pair<int, int>& startPosition,
                   const std::pair<int, int>& endPosition);
+    void erasePath(const std::pair<int, int>& startPosition,
+                   const std::pair<int, int>& endPosition);
                   
     void setNodeIcons(const std::pair<int, int>& position,
-                      const std::vector<std::shared_ptr<QIcon>>& icons);
+                      const std::vector<const QIcon*>& icons);
+    // Composes what the node would draw with these icons, unselected,
+    // so that showing them later is only a copy
+    void warmNodeIcons(const std::pair<int, int>& position,
+                       const std::vector<const QIcon*>& icons);
     void deselectAllNodes();
     void resetAllNodeIcons();
     
     std::pair<int, int> getResolution();
     
     static constexpr const char* WINDOW_NAME = "NodeUI";
+    // Pace of sprite animation. Nothing is painted between
+    // frames unless something changes.
     static constexpr int FRAMERATE = 60;
-    
-    static constexpr int HORIZONTAL_NODE_NUM = 3;
-    static constexpr int VERTICAL_NODE_NUM = 3;
+    static constexpr int PATH_WIDTH = 20;
     
     static constexpr double HORIZONTAL_PADDING = 0.2;
     static constexpr double VERTICAL_PADDING = 0.2;
     
-    int timerID;
-    
+    static constexpr QEvent::Type WAKE_EVENT =
+        static_cast<QEvent::Type>(QEvent::User + 1);
+    static constexpr QEvent::Type SHOWN_EVENT =
+        static_cast<QEvent::Type>(QEvent::User + 2);
+        
   protected:
     void timerEvent(QTimerEvent* event);
     void keyPressEvent(QKeyEvent* event);
     void paintEvent(QPaintEvent* event);
+    void resizeEvent(QResizeEvent* event) override;
     void closeEvent(QCloseEvent* event);
     
     void changeEvent(QEvent* event);
+    void customEvent(QEvent* event) override;
     
     void focusInEvent(QFocusEvent* event) override;
     void focusOutEvent(QFocusEvent* event) override;
   private:
-    void render(QPainter& painter);
+    // Places every sprite for the current size, creating them the
+    // first time
+    void layoutScene();
+    // Joins every path into one, only after paths were drawn or erased
+    void layoutPaths();
+    // Renders what lies in the region, which must already be clear
+    void render(QPainter& painter, const QRegion& region);
+    // Brings the backing store up to date, redrawing only the damage
+    // unless it has never been drawn
+    void renderBackingStore();
+    // Schedules a node to be redrawn and painted
+    void markDirty(const std::pair<int, int>& position);
+    // Schedules an area to be redrawn and painted
+    void invalidate(const QRect& rect);
+    // Asks for an animation tick, at most one ever being pending
+    void requestFrame();
+    
+    QPoint getCenter(const std::pair<int, int>& position) const;
+    QRect getPathBounds(const coord_pair& path) const;
     
     util::WindowProperties properties;
+    GridGeometry grid;
     std::function<void(QKeyEvent*)> controller;
     std::function<void(const bool& hasFocus)> focusHandler;
+    std::function<void()> wakeHandler;
+    std::function<void()> shownHandler;
     
     std::unordered_map<std::pair<int, int>, std::shared_ptr<NodeSprite>, pairhash>
     nodesprites;
     
     std::set<coord_pair> pathOverlay;
+    
+    // Laid out ahead of time, so that rendering only draws
+    std::vector<QPoint> centers;
+    QPainterPath paths;
+    QRect pathsBounds;
+    bool pathsValid;
+    QPen pathPen;
+    
+    // Last rendered frame, painted again as is while nothing changes
+    QPixmap backingStore;
+    bool backingStoreValid;
+    // Parts of the backing store that are out of date
+    QRegion damage;
+    // Animated sprites change every frame
+    bool animated;
+    // Timer of the pending animation tick, or 0
+    int frameTimer;
+    
+    bool firstFramePending;
+    std::chrono::steady_clock::time_point showRequested;
+    ShowStatistics showStatistics;
 };
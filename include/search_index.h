@@ -0,0 +1,106 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "util.h"
+#include "model.h"
+
+// Type-ahead index over the names and command lines of every command in a
+// tree. Queries shorter than a trigram match the start of words, longer ones
+// are matched by the trigrams they share with each entry, which tolerates
+// a typo or two.
+class SearchIndex {
+  public:
+    typedef std::shared_ptr<const Model::command_tree> tree_ptr;
+    
+    explicit SearchIndex(tree_ptr tree);
+    
+    size_t size() const;
+    
+    // Gets the tree the index was built from
+    const tree_ptr& getTree() const;
+    
+    // Incremental search over an index. Changing the query only redoes
+    // the work for the trigrams that changed, so typing or deleting a
+    // character walks a single posting list.
+    class Session {
+      public:
+        explicit Session(std::shared_ptr<const SearchIndex> index);
+        
+        void setQuery(const std::string& query);
+        const std::string& getQuery() const;
+        
+        // Best matches first, at most MAX_RESULTS of them
+        const std::vector<command_handle>& getResults() const;
+        
+      private:
+        void addTrigram(uint32_t trigram);
+        void removeTrigram(uint32_t trigram);
+        void rankPrefixes();
+        void rankTrigrams();
+        void keepBest(std::vector<std::pair<int, uint32_t>>& scored);
+        
+        std::shared_ptr<const SearchIndex> index;
+        std::string query;
+        
+        // Distinct trigrams of the query and how often each occurs
+        std::vector<std::pair<uint32_t, int>> queryTrigrams;
+        
+        // Number of query trigrams found in each entry, and the entries
+        // that have had at least one since touched was last compacted
+        std::vector<uint16_t> counts;
+        std::vector<bool> listed;
+        std::vector<uint32_t> touched;
+        
+        std::vector<command_handle> results;
+    };
+    
+    // Enough to fill the root node and its neighbours
+    static constexpr size_t MAX_RESULTS = 9;
+    
+  private:
+    // Keys are trigrams and the first one or two characters of every word,
+    // over an alphabet small enough to address every key directly
+    static constexpr uint32_t ALPHABET_SIZE = 38;
+    static constexpr uint32_t KEY_COUNT = ALPHABET_SIZE * ALPHABET_SIZE *
+                                          ALPHABET_SIZE + ALPHABET_SIZE + ALPHABET_SIZE * ALPHABET_SIZE;
+                                          
+    static uint32_t getSymbol(char c);
+    static uint32_t getTrigramKey(const char* text);
+    static uint32_t getPrefixKey(const char* text, size_t length);
+    
+    // Gets the entries containing a key, in ascending order
+    util::Span<uint32_t> getPostings(uint32_t key) const;
+    
+    tree_ptr tree;
+    util::Span<command_handle> commands;
+    
+    // Lower case name of each entry, followed by its command line
+    std::vector<std::string> texts;
+    std::vector<uint32_t> nameLengths;
+    
+    // The entries of the nth key are postings[offsets[n]] up to
+    // postings[offsets[n + 1]]
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> postings;
+};
@@ -0,0 +1,55 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "util.h"
+#include "node.h"
+#include "model.h"
+
+// Compiled, versioned image of the command tree built from the application
+// list. The node arena is mapped and navigated in place, so starting up does
+// not need to parse the JSON or rebuild the tree.
+class TrieImage {
+  public:
+    // Writes the model's tree along with its command strings and icon
+    // names. The image remembers the source file and grid it was built
+    // from so that it can tell when it has gone stale.
+    static void compile(const Model& model,
+                        const std::string& imageFile,
+                        const std::string& sourceFile);
+                        
+    // Maps an image, returning nullptr if it is missing, malformed or
+    // out of date with respect to its source file or grid. Commands
+    // are registered as they are read.
+    static std::shared_ptr<const Model::command_tree> load(
+        const std::string& imageFile, const std::string& sourceFile,
+        const GridGeometry& grid);
+        
+    // True if path was modified after the image was last written
+    static bool modifiedSince(const std::string& path,
+                              const std::string& imageFile);
+                              
+    // Marks the image as up to date without rewriting it
+    static void touch(const std::string& imageFile);
+    
+    static constexpr uint32_t VERSION = 2;
+};
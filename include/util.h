@@ -57,18 +57,39 @@ namespace util {
     typedef std::vector<std::pair<int, int>> vec2i;
     typedef std::shared_ptr<std::vector<std::pair<int, int>>> vec2i_ptr;
     
-    static constexpr int GRID_WIDTH = 3;
-    static constexpr int GRID_HEIGHT = 3;
-    
     struct WindowProperties {
         int width;
         int height;
     };
     
-    struct Command {
-        std::string name;
-        std::string command;
-        std::shared_ptr<QIcon> icon;
+    // Non-owning view over a contiguous run of elements
+    template <class T>
+    struct Span {
+        Span() : first(nullptr), last(nullptr) { }
+        Span(const T* first, const T* last) : first(first), last(last) { }
+        
+        const T* begin() const {
+            return first;
+        }
+        
+        const T* end() const {
+            return last;
+        }
+        
+        size_t size() const {
+            return last - first;
+        }
+        
+        bool empty() const {
+            return first == last;
+        }
+        
+        const T& operator[](size_t index) const {
+            return first[index];
+        }
+        
+        const T* first;
+        const T* last;
     };
     
     static std::unordered_map<int, std::string> keyToString = {
@@ -80,10 +101,6 @@ namespace util {
         {Qt::Key_Escape, "Escape"},
     };
     
-    inline std::ostream& operator<<(std::ostream& strm, Command const& command) {
-        return strm << command.name;
-    }
-
     inline static uint64_t timestamp() {
         return std::chrono::duration_cast<std::chrono::milliseconds>(
                    std::chrono::system_clock::now().time_since_epoch()).
@@ -99,6 +116,9 @@ namespace util {
                                        std::pair<double, double> coords);
                                        
     void executeCommand(std::string command);
+    
+    // Strips leading and trailing whitespace
+    std::string trim(const std::string& text);
 }
 
 // Defined int pair addition
@@ -0,0 +1,84 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "util.h"
+#include "grid.h"
+#include "model.h"
+#include "command_registry.h"
+
+// What the overlay shows, cell by cell. The controller keeps the state that
+// is on screen and builds the next one after every action, so that only the
+// cells that differ between the two are touched.
+class ViewState {
+  public:
+    enum class Tint : uint8_t {
+        NONE,
+        SELECTED,
+        HIGHLIGHTED
+    };
+    
+    struct Cell {
+        Tint tint;
+        // Commands whose icons are shown, copied so that a state
+        // outlives changes to the tree it was built from
+        std::vector<command_handle> commands;
+    };
+    
+    // Line between the centers of two cells, smallest cell first
+    typedef std::pair<int, int> segment;
+    
+    // Changes that turn one state into another
+    struct Delta {
+        std::vector<int> tinted;
+        std::vector<int> iconsChanged;
+        std::vector<segment> segmentsAdded;
+        std::vector<segment> segmentsRemoved;
+        
+        bool empty() const;
+    };
+    
+    explicit ViewState(const GridGeometry& grid = GridGeometry());
+    
+    // Blank overlay
+    void clear();
+    
+    // The path taken so far, ending at the current node, with the
+    // icons of every move that can be made from it
+    void showModel(const Model& model);
+    
+    // The best match on the root and the rest around it
+    void showResults(const std::vector<command_handle>& results);
+    
+    const Cell& getCell(int cell) const;
+    const std::vector<segment>& getSegments() const;
+    
+    // Fills delta with what changes going from this state to next,
+    // reusing its storage
+    void diff(const ViewState& next, Delta& delta) const;
+    
+  private:
+    void addSegment(int from, int to);
+    
+    GridGeometry grid;
+    std::vector<Cell> cells;
+    // Sorted and unique
+    std::vector<segment> segments;
+};
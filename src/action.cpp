@@ -0,0 +1,69 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#include <algorithm>
+
+#include "action.h"
+
+constexpr size_t Action::MAX_TEXT;
+
+namespace {
+    // Indexed by Action::Type, moves are named by direction instead
+    const char* const TYPE_NAMES[] = {
+        "NONE", "MOVE", "BACK", "EXIT", "SHOW", "TOGGLE", "SEARCH",
+        "SEARCH_TYPE", "SEARCH_ERASE", "SEARCH_CANCEL", "SEARCH_RUN"
+    };
+    
+    const size_t TYPE_COUNT = sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]);
+    
+    const std::string TYPE_SEPARATOR = ":";
+}
+
+Action Action::character(const char* text, size_t length) {
+    Action action(Type::SEARCH_TYPE);
+    length = std::min(length, getCharacterLength(text[0]));
+    std::memcpy(action.text, text, length);
+    return action;
+}
+
+std::string Action::toString() const {
+    if (this->type == Type::MOVE)
+        return directionToString(this->direction);
+    std::string name = TYPE_NAMES[static_cast<size_t>(this->type)];
+    if (this->type == Type::SEARCH_TYPE)
+        name += TYPE_SEPARATOR + std::string(this->text, this->getTextLength());
+    return name;
+}
+
+Action Action::fromString(const std::string& name) {
+    Direction direction = directionFromString(name);
+    if (direction != Direction::INVALID)
+        return Action::move(direction);
+        
+    const std::string typing = std::string(TYPE_NAMES[static_cast<size_t>
+                                           (Type::SEARCH_TYPE)]) + TYPE_SEPARATOR;
+    if (name.size() > typing.size() &&
+            name.compare(0, typing.size(), typing) == 0)
+        return Action::character(name.data() + typing.size(),
+                                 name.size() - typing.size());
+                                 
+    // Moves have to name their direction
+    for (size_t i = 0; i < TYPE_COUNT; i++)
+        if (name == TYPE_NAMES[i] && static_cast<Type>(i) != Type::MOVE &&
+                static_cast<Type>(i) != Type::SEARCH_TYPE)
+            return Action(static_cast<Type>(i));
+    return Action();
+}
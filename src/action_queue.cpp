@@ -0,0 +1,109 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+#include "action_queue.h"
+
+constexpr size_t ActionQueue::CAPACITY;
+
+ActionQueue::ActionQueue(size_t capacity) :
+    mask(0),
+    tail(0),
+    pushed(0),
+    dropped(0),
+    head(0),
+    popped(0),
+    totalLatency(0),
+    maxLatency(0) {
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    this->cells.reset(new Cell[size]);
+    this->mask = size - 1;
+    for (size_t i = 0; i < size; i++)
+        this->cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool ActionQueue::push(const Action& action) {
+    size_t position = this->tail.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &this->cells[position & this->mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) -
+                              static_cast<intptr_t>(position);
+        if (difference == 0) {
+            // Claim the cell, unless another producer got there first
+            if (this->tail.compare_exchange_weak(position, position + 1,
+                                                 std::memory_order_relaxed))
+                break;
+        } else if (difference < 0) {
+            // The consumer hasn't freed this cell since the last lap
+            this->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            position = this->tail.load(std::memory_order_relaxed);
+        }
+    }
+    
+    cell->action = action;
+    cell->timestamp = now();
+    cell->sequence.store(position + 1, std::memory_order_release);
+    this->pushed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ActionQueue::pop(Action& action) {
+    Cell& cell = this->cells[this->head & this->mask];
+    if (cell.sequence.load(std::memory_order_acquire) != this->head + 1)
+        return false;
+        
+    action = cell.action;
+    uint64_t latency = now() - cell.timestamp;
+    this->totalLatency += latency;
+    this->maxLatency = std::max(this->maxLatency, latency);
+    this->popped++;
+    
+    // Free the cell for the producer that comes by on the next lap
+    cell.sequence.store(this->head + this->mask + 1, std::memory_order_release);
+    this->head++;
+    return true;
+}
+
+bool ActionQueue::isFull() const {
+    size_t position = this->tail.load(std::memory_order_relaxed);
+    const Cell& cell = this->cells[position & this->mask];
+    return cell.sequence.load(std::memory_order_acquire) != position;
+}
+
+ActionQueue::Statistics ActionQueue::getStatistics() const {
+    const double nanosecondsPerMs = 1e6;
+    return {this->pushed.load(std::memory_order_relaxed),
+            this->dropped.load(std::memory_order_relaxed),
+            this->popped,
+            this->popped == 0 ? 0.0 :
+            this->totalLatency / nanosecondsPerMs / this->popped,
+            this->maxLatency / nanosecondsPerMs
+           };
+}
+
+uint64_t ActionQueue::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,129 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#include <algorithm>
+#include <stdexcept>
+#include <iterator>
+
+#include "action_recorder.h"
+
+constexpr uint32_t ActionRecorder::VERSION;
+
+namespace {
+    const char MAGIC[4] = {'N', 'U', 'I', 'R'};
+    
+    void writeVarint(std::ostream& output, uint64_t value) {
+        while (value >= 0x80) {
+            output.put(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        output.put(static_cast<char>(value));
+    }
+    
+    // Reads from position, which is left after what was read
+    uint8_t readByte(const std::string& data, size_t& position) {
+        if (position >= data.size())
+            throw std::runtime_error("Recording ends in the middle of an action");
+        return static_cast<uint8_t>(data[position++]);
+    }
+    
+    uint64_t readVarint(const std::string& data, size_t& position) {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = readByte(data, position);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        throw std::runtime_error("Recording has a malformed time");
+    }
+}
+
+ActionRecorder::ActionRecorder(const std::string& file) :
+    mutex(),
+    output(file, std::ios::binary | std::ios::trunc),
+    start(std::chrono::steady_clock::now()),
+    lastTime(0) {
+    if (!this->output)
+        throw std::runtime_error("Failed to open recording " + file);
+    this->output.write(MAGIC, 4);
+    this->output.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+}
+
+void ActionRecorder::record(const Action& action) {
+    uint64_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - this->start).count();
+                        
+    std::lock_guard<std::mutex> lock(this->mutex);
+    // Producers can get here out of order, in which case
+    // the later one is recorded as happening at once
+    writeVarint(this->output, time > this->lastTime ? time - this->lastTime : 0);
+    this->lastTime = std::max(this->lastTime, time);
+    this->output.put(static_cast<char>(action.type));
+    if (action.type == Action::Type::MOVE) {
+        this->output.put(static_cast<char>(action.direction));
+    } else if (action.type == Action::Type::SEARCH_TYPE) {
+        size_t length = action.getTextLength();
+        this->output.put(static_cast<char>(length));
+        this->output.write(action.text, length);
+    }
+    // Flushed as it goes, so that a crash leaves the sequence that caused it
+    this->output.flush();
+}
+
+std::vector<ActionRecorder::Entry> ActionRecorder::load(
+    const std::string& file) {
+    std::ifstream input(file, std::ios::binary);
+    if (!input)
+        throw std::runtime_error("Failed to open recording " + file);
+    std::string data((std::istreambuf_iterator<char>(input)),
+                     std::istreambuf_iterator<char>());
+                     
+    uint32_t version = 0;
+    if (data.size() < 4 + sizeof(version) ||
+            data.compare(0, 4, MAGIC, 4) != 0)
+        throw std::runtime_error(file + " is not a recording");
+    std::copy(data.begin() + 4, data.begin() + 4 + sizeof(version),
+              reinterpret_cast<char*>(&version));
+    if (version != VERSION)
+        throw std::runtime_error(file + " was recorded by another version");
+        
+    std::vector<Entry> entries;
+    size_t position = 4 + sizeof(version);
+    uint64_t time = 0;
+    while (position < data.size()) {
+        time += readVarint(data, position);
+        uint8_t type = readByte(data, position);
+        if (type > static_cast<uint8_t>(Action::Type::SEARCH_RUN))
+            throw std::runtime_error("Recording has an unknown action");
+            
+        Action action(static_cast<Action::Type>(type));
+        if (action.type == Action::Type::MOVE) {
+            action.direction = static_cast<Direction>(readByte(data, position));
+            if (action.direction >= Direction::INVALID)
+                throw std::runtime_error("Recording has an unknown direction");
+        } else if (action.type == Action::Type::SEARCH_TYPE) {
+            size_t length = readByte(data, position);
+            if (length == 0 || length > Action::MAX_TEXT ||
+                    position + length > data.size())
+                throw std::runtime_error("Recording has malformed text");
+            action = Action::character(data.data() + position, length);
+            position += length;
+        }
+        entries.push_back(Entry {time, action});
+    }
+    return entries;
+}
@@ -0,0 +1,93 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#include <stdexcept>
+
+#include "command_registry.h"
+
+std::unordered_set<std::string> CommandRegistry::strings;
+std::vector<CommandRegistry::Entry> CommandRegistry::entries;
+std::unordered_map<CommandRegistry::Entry, command_handle,
+    CommandRegistry::EntryHash> CommandRegistry::handles;
+std::vector<std::unique_ptr<QIcon>> CommandRegistry::icons;
+std::unordered_map<const std::string*, uint32_t> CommandRegistry::iconSlots;
+
+size_t CommandRegistry::EntryHash::operator()(const Entry& entry) const {
+    std::hash<const std::string*> hash;
+    size_t seed = hash(entry.name);
+    seed ^= hash(entry.command) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= hash(entry.iconName) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+command_handle CommandRegistry::add(const std::string& name,
+                                    const std::string& command,
+                                    const std::string& iconName) {
+    Entry entry = {intern(name), intern(command), intern(iconName), 0};
+    auto found = handles.find(entry);
+    if (found != handles.end())
+        return found->second;
+        
+    if (entries.size() >= NO_COMMAND)
+        throw std::runtime_error("Too many commands to register " + command);
+    auto slot = iconSlots.emplace(entry.iconName, icons.size());
+    if (slot.second)
+        icons.emplace_back();
+    entry.icon = slot.first->second;
+    
+    const command_handle handle = entries.size();
+    entries.push_back(entry);
+    handles.emplace(entry, handle);
+    return handle;
+}
+
+const std::string& CommandRegistry::getName(command_handle handle) {
+    return *(getEntry(handle).name);
+}
+
+const std::string& CommandRegistry::getCommand(command_handle handle) {
+    return *(getEntry(handle).command);
+}
+
+const std::string& CommandRegistry::getIconName(command_handle handle) {
+    return *(getEntry(handle).iconName);
+}
+
+const QIcon* CommandRegistry::getIcon(command_handle handle) {
+    const Entry& entry = getEntry(handle);
+    std::unique_ptr<QIcon>& icon = icons[entry.icon];
+    if (icon == nullptr)
+        icon.reset(new QIcon(QIcon::fromTheme(
+                                 QString::fromStdString(*(entry.iconName)))));
+    return icon.get();
+}
+
+size_t CommandRegistry::size() {
+    return entries.size();
+}
+
+const std::string* CommandRegistry::intern(const std::string& str) {
+    // Elements of an unordered_set never move, so the pointer is stable
+    return &*(strings.insert(str).first);
+}
+
+const CommandRegistry::Entry& CommandRegistry::getEntry(
+    command_handle handle) {
+    if (handle >= entries.size())
+        throw std::runtime_error("Unknown command handle " +
+                                 std::to_string(handle));
+    return entries[handle];
+}
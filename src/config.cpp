@@ -26,8 +26,8 @@ std::string Config::readFile(const std::string& filename) {
                        std::istreambuf_iterator<char>());
 }
 
-std::string Config::writeFile(const std::string& filename,
-                              const std::string& contents) {
+void Config::writeFile(const std::string& filename,
+                       const std::string& contents) {
     std::ofstream filestream(filename);
     filestream << contents;
 }
@@ -40,11 +40,11 @@ void Config::readConfig() {
         throw std::runtime_error("Config file is not valid JSON");
 }
 
-std::shared_ptr<std::vector<std::pair<util::Command, util::vec2i_ptr>>>
+std::shared_ptr<std::vector<std::pair<command_handle, util::vec2i_ptr>>>
 Config::readApplications() {
     auto output =
-        std::shared_ptr<std::vector<std::pair<util::Command, util::vec2i_ptr>>>(
-            new std::vector<std::pair<util::Command, util::vec2i_ptr>>);
+        std::shared_ptr<std::vector<std::pair<command_handle, util::vec2i_ptr>>>(
+            new std::vector<std::pair<command_handle, util::vec2i_ptr>>);
     if (appRoot == nullptr)
         appRoot = std::shared_ptr<Json::Value>(new Json::Value);
         
@@ -58,38 +58,58 @@ Config::readApplications() {
         const Json::Value entry = applicationList[index];
         std::string command = entry["command"].asString();
         std::string name = entry["name"].asString();
-        QString iconName = QString::fromStdString(entry["icon"].asString());
+        std::string iconName = entry["icon"].asString();
         
-        auto icon = std::make_shared<QIcon>(QIcon::fromTheme(iconName));
-        
-        util::vec2i_ptr pathValues(new util::vec2i);
-        if (entry.isMember("path")) {
-            const Json::Value commandPath = entry["path"];
-            for (int i = 0; i < commandPath.size(); i++) {
-                const Json::Value coordinate = commandPath[i];
-                std::string errorPrefix = "Path associated with command "
-                                          + entry["command"].asString();
-                if (coordinate.size() != 2)
-                    throw std::runtime_error(errorPrefix
-                                             + " does " + "not have the" +
-                                             " correct number" + " of coordinates");
-                if (!coordinate[0].isInt() || !coordinate[1].isInt())
-                    throw std::runtime_error(errorPrefix + " does not have valid "
-                                             + "coordinates");
-                std::pair<int, int> coord = {coordinate[0].asInt(),
-                                             coordinate[1].asInt()
-                                            };
-                pathValues->push_back(coord);
-            }
-        }
-        
-        std::pair<util::Command, util::vec2i_ptr> pos =
-            {util::Command({name, command, icon}), pathValues};
-        output->push_back(pos);
+        util::vec2i_ptr pathValues = readPath(entry["path"], command);
+        output->push_back(std::make_pair(CommandRegistry::add(name, command,
+                                         iconName), pathValues));
+    }
+    return output;
+}
+
+std::unordered_map<std::string, std::vector<std::pair<command_handle, util::vec2i_ptr>>>
+Config::readContexts(const std::vector<std::pair<command_handle, util::vec2i_ptr>>&
+                     applications) {
+    std::unordered_map<std::string,
+        std::vector<std::pair<command_handle, util::vec2i_ptr>>> output;
+    const Json::Value applicationList = (*appRoot)["applications"];
+    for (int index = 0; index < applicationList.size(); index++) {
+        const Json::Value contexts = applicationList[index]["contexts"];
+        if (!contexts.isObject())
+            continue;
+            
+        // Entries line up with the applications read from the same file,
+        // so every context refers to the same commands
+        const command_handle command = applications[index].first;
+        for (auto& windowClass : contexts.getMemberNames())
+            output[windowClass].push_back(std::make_pair(command,
+                                          readPath(contexts[windowClass],
+                                                  CommandRegistry::getCommand(command))));
     }
     return output;
 }
 
+util::vec2i_ptr Config::readPath(const Json::Value& commandPath,
+                                 const std::string& command) {
+    util::vec2i_ptr pathValues(new util::vec2i);
+    for (int i = 0; i < commandPath.size(); i++) {
+        const Json::Value coordinate = commandPath[i];
+        std::string errorPrefix = "Path associated with command " + command;
+        if (coordinate.size() != 2)
+            throw std::runtime_error(errorPrefix
+                                     + " does " + "not have the" +
+                                     " correct number" + " of coordinates");
+        if (!coordinate[0].isInt() || !coordinate[1].isInt())
+            throw std::runtime_error(errorPrefix + " does not have valid "
+                                     + "coordinates");
+        std::pair<int, int> coord = {coordinate[0].asInt(),
+                                     coordinate[1].asInt()
+                                    };
+        pathValues->push_back(coord);
+    }
+    return pathValues;
+}
+
 QColor Config::getColor(std::string name) {
     const Json::Value color = (*root)["colors"][name];
     if (color.size() != 4)
@@ -100,6 +120,12 @@ QColor Config::getColor(std::string name) {
     return QColor(colorArray[0], colorArray[1], colorArray[2], colorArray[3]);
 }
 
+GridGeometry Config::getGrid() {
+    return GridGeometry::create(
+               (*root).get("grid_width", DEFAULT_GRID_SIZE).asInt(),
+               (*root).get("grid_height", DEFAULT_GRID_SIZE).asInt());
+}
+
 void Config::updateApplicationList(std::string applicationDirectory) {
     DEBUG("Updating config with new applications from directory " <<
           applicationDirectory);
@@ -107,9 +133,9 @@ void Config::updateApplicationList(std::string applicationDirectory) {
     tinydir_open_sorted(&appDir, applicationDirectory.c_str());
     
     auto alreadyExistingApps = * Config::readApplications();
-    std::unordered_map<std::string, util::Command> associations;
+    std::unordered_map<std::string, command_handle> associations;
     for (auto& app : alreadyExistingApps)
-        associations[app.first.name] = app.first;
+        associations[CommandRegistry::getName(app.first)] = app.first;
         
     int newApps = 0;
     for (int i = 0; i < appDir.n_files; i++) {
@@ -169,6 +195,10 @@ void Config::updateApplicationList(std::string applicationDirectory) {
     
     DEBUG("Found " << newApps << " new applications.");
     
+    // Leave the file alone so that its compiled image stays valid
+    if (newApps == 0)
+        return;
+        
     Json::StyledWriter writer;
     Config::writeFile(Config::APP_FILE, writer.write(*appRoot));
 }
@@ -0,0 +1,118 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "config.h"
+#include "context_set.h"
+
+namespace {
+    const char IMAGE_EXTENSION[] = "trie";
+    
+    std::string getImageFile(const std::string& directory,
+                             const std::string& windowClass) {
+        return directory + "/" + windowClass + "." + IMAGE_EXTENSION;
+    }
+    
+    // Lists the window classes that have an image in directory
+    bool listImages(const std::string& directory,
+                    std::vector<std::string>& windowClasses) {
+        tinydir_dir dir;
+        if (tinydir_open(&dir, directory.c_str()) == -1)
+            return false;
+            
+        // The extension and its dot
+        const size_t suffix = sizeof(IMAGE_EXTENSION);
+        for (; dir.has_next; tinydir_next(&dir)) {
+            tinydir_file file;
+            tinydir_readfile(&dir, &file);
+            if (file.is_dir || strcmp(file.extension, IMAGE_EXTENSION) != 0)
+                continue;
+            std::string name = file.name;
+            windowClasses.push_back(name.substr(0, name.size() - suffix));
+        }
+        tinydir_close(&dir);
+        return true;
+    }
+}
+
+ContextSet::ContextSet(tree_ptr defaultTree) :
+    defaultTree(std::move(defaultTree)),
+    trees() {
+}
+
+void ContextSet::add(const std::string& windowClass, tree_ptr tree) {
+    this->trees[windowClass] = std::move(tree);
+}
+
+const ContextSet::tree_ptr& ContextSet::get(
+    const std::string& windowClass) const {
+    auto found = this->trees.find(windowClass);
+    if (found == this->trees.end())
+        return this->defaultTree;
+    return found->second;
+}
+
+const ContextSet::tree_ptr& ContextSet::getDefault() const {
+    return this->defaultTree;
+}
+
+void ContextSet::setDefault(tree_ptr tree) {
+    this->defaultTree = std::move(tree);
+}
+
+size_t ContextSet::size() const {
+    return this->trees.size();
+}
+
+void ContextSet::compile(const std::string& directory,
+                         const std::string& sourceFile,
+                         const GridGeometry& grid) const {
+    mkdir(directory.c_str(), 0755);
+    
+    std::vector<std::string> stale;
+    listImages(directory, stale);
+    for (auto& windowClass : stale)
+        if (this->trees.count(windowClass) == 0)
+            std::remove(getImageFile(directory, windowClass).c_str());
+            
+    for (auto& context : this->trees)
+        TrieImage::compile(Model(context.second, grid),
+                           getImageFile(directory, context.first), sourceFile);
+}
+
+bool ContextSet::load(const std::string& directory,
+                      const std::string& sourceFile,
+                      const GridGeometry& grid) {
+    std::vector<std::string> windowClasses;
+    if (!listImages(directory, windowClasses))
+        return false;
+        
+    std::unordered_map<std::string, tree_ptr> loaded;
+    for (auto& windowClass : windowClasses) {
+        tree_ptr tree = TrieImage::load(getImageFile(directory, windowClass),
+                                        sourceFile, grid);
+        if (tree == nullptr)
+            return false;
+        loaded[windowClass] = tree;
+    }
+    this->trees.swap(loaded);
+    return true;
+}
@@ -0,0 +1,195 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "util.h"
+#include "control_server.h"
+
+namespace {
+    sockaddr_un toAddress(const std::string& path) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("Control socket path is too long: " + path);
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        return address;
+    }
+}
+
+bool ControlServer::Watcher::event(QEvent* event) {
+    if (event->type() == QEvent::SockAct) {
+        this->onActivated();
+        return true;
+    }
+    return QSocketNotifier::event(event);
+}
+
+ControlServer::ControlServer(const std::string& path, handler onRequest) :
+    path(path),
+    onRequest(onRequest),
+    listener(-1),
+    listenerWatcher(nullptr),
+    clients() {
+    sockaddr_un address = toAddress(path);
+    
+    // A socket left behind by an instance that died can be replaced,
+    // one that still answers can't
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bool running = probe != -1 && connect(probe,
+                                          reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    if (probe != -1)
+        ::close(probe);
+    if (running)
+        throw std::runtime_error("NodeUI is already listening on " + path);
+    unlink(path.c_str());
+    
+    this->listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                            0);
+    if (this->listener == -1)
+        throw std::runtime_error("Failed to create the control socket");
+    // Only the user running NodeUI can launch through it
+    mode_t mask = umask(0077);
+    int bound = bind(this->listener, reinterpret_cast<sockaddr*>(&address),
+                     sizeof(address));
+    umask(mask);
+    if (bound == -1 || listen(this->listener, SOMAXCONN) == -1) {
+        std::string error = std::strerror(errno);
+        ::close(this->listener);
+        throw std::runtime_error("Failed to listen on " + path + ": " + error);
+    }
+    
+    this->listenerWatcher = new Watcher(this->listener, QSocketNotifier::Read,
+    [this]() {
+        this->accept();
+    });
+    DEBUG("Listening for launch requests on " << path);
+}
+
+ControlServer::~ControlServer() {
+    while (!this->clients.empty())
+        this->close(this->clients.begin()->first);
+    delete this->listenerWatcher;
+    ::close(this->listener);
+    unlink(this->path.c_str());
+}
+
+void ControlServer::accept() {
+    int socket;
+    while ((socket = accept4(this->listener, nullptr, nullptr,
+                             SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        Watcher* reader = new Watcher(socket, QSocketNotifier::Read,
+        [this, socket]() {
+            this->read(socket);
+        });
+        Watcher* writer = new Watcher(socket, QSocketNotifier::Write,
+        [this, socket]() {
+            this->flush(socket);
+        });
+        writer->setEnabled(false);
+        this->clients[socket] = Client {reader, writer, std::string(),
+                                        std::string(), false
+                                       };
+    }
+}
+
+void ControlServer::read(int socket) {
+    Client& client = this->clients.at(socket);
+    char buffer[1024];
+    ssize_t received = 1;
+    // Requests are handled as they arrive, so a client can batch many of
+    // them without waiting for replies. One that sends faster than it
+    // reads is held up until its replies went out instead of losing them.
+    while (client.output.empty() && !client.finished &&
+            (received = recv(socket, buffer, sizeof(buffer), 0)) > 0) {
+        client.input.append(buffer, received);
+        
+        size_t start = 0;
+        size_t end;
+        while ((end = client.input.find('\n', start)) != std::string::npos) {
+            this->reply(client, client.input.substr(start, end - start));
+            start = end + 1;
+        }
+        client.input.erase(0, start);
+        
+        if (client.input.size() > ControlSocket::MAX_REQUEST) {
+            this->reply(client, std::string());
+            client.finished = true;
+        }
+    }
+    
+    if (received == 0) {
+        // The client is done sending, the last request may lack a newline
+        if (!client.input.empty())
+            this->reply(client, client.input);
+        client.finished = true;
+    } else if (received == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        this->close(socket);
+        return;
+    }
+    this->flush(socket);
+}
+
+void ControlServer::reply(Client& client, const std::string& request) {
+    std::string response = request.empty() ?
+                           std::string(ControlSocket::REPLY_ERROR) + "\tEmpty or overlong request" :
+                           this->onRequest(request);
+    client.output += response + '\n';
+}
+
+void ControlServer::flush(int socket) {
+    Client& client = this->clients.at(socket);
+    while (!client.output.empty()) {
+        ssize_t written = send(socket, client.output.data(), client.output.size(),
+                               MSG_NOSIGNAL);
+        if (written == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (written <= 0) {
+            this->close(socket);
+            return;
+        }
+        client.output.erase(0, written);
+    }
+    
+    const bool pending = !client.output.empty();
+    if (!pending && client.finished) {
+        this->close(socket);
+        return;
+    }
+    client.writer->setEnabled(pending);
+    client.reader->setEnabled(!pending && !client.finished);
+}
+
+void ControlServer::close(int socket) {
+    auto client = this->clients.find(socket);
+    if (client == this->clients.end())
+        return;
+    // Possibly called from either watcher's own event
+    client->second.reader->setEnabled(false);
+    client->second.reader->deleteLater();
+    client->second.writer->setEnabled(false);
+    client->second.writer->deleteLater();
+    this->clients.erase(client);
+    ::close(socket);
+}
@@ -15,84 +15,434 @@
 // You should have received a copy of the GNU General Public License along
 // with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <sstream>
+
 #include "controller.h"
 
 
-void onReceive(std::string str, Controller* controller) {
-    DEBUG(str);
-    if (str == "EXIT") {
-        controller->hideAll();
-        return;
+void onReceive(const Action& action, Controller* controller) {
+    switch (action.type) {
+        case Action::Type::EXIT:
+            controller->hideAll();
+            return;
+        case Action::Type::SHOW:
+            controller->showAll();
+            return;
+        case Action::Type::TOGGLE: {
+            std::chrono::steady_clock::time_point requested;
+            std::string windowClass = controller->takeWindowClass(requested);
+            // Replayed toggles never went through the hotkey
+            if (requested == std::chrono::steady_clock::time_point())
+                requested = std::chrono::steady_clock::now();
+            controller->toggleOverlay(windowClass, requested);
+            return;
+        }
+        case Action::Type::SEARCH_TYPE:
+        case Action::Type::SEARCH_ERASE:
+        case Action::Type::SEARCH_CANCEL:
+            controller->editSearch(action);
+            return;
+        case Action::Type::SEARCH_RUN:
+            controller->runSearch();
+            return;
+        case Action::Type::BACK:
+            controller->model.back();
+            break;
+        case Action::Type::MOVE:
+            controller->model.advance(action.direction);
+            break;
+        default:
+            return;
     }
+    
+    command_handle command = controller->model.getCommand();
+    if (command != NO_COMMAND)
+        controller->launch(command);
+    else
+        controller->predictor.predict(controller->model);
+        
+    controller->updateView();
+}
+
+Controller::~Controller() {
+    for (auto& device : this->inputDevices)
+        device->stop();
+}
+
+void Controller::updateView() {
+    if (this->searchSession != nullptr)
+        this->next.showResults(this->searchSession->getResults());
+    else
+        this->next.showModel(this->model);
+    this->applyView();
+}
+
+void Controller::applyView() {
+    this->shown.diff(this->next, this->delta);
+    const GridGeometry& grid = this->model.getGrid();
+    
+    // Paths go first, then the tint of the cells they end on
+    for (auto& segment : this->delta.segmentsRemoved)
+        this->screen->erasePath(grid.toPosition(segment.first),
+                                grid.toPosition(segment.second));
+    for (auto& segment : this->delta.segmentsAdded)
+        this->screen->drawPath(grid.toPosition(segment.first),
+                               grid.toPosition(segment.second));
+                               
+    for (int cell : this->delta.tinted) {
+        const std::pair<int, int> position = grid.toPosition(cell);
+        switch (this->next.getCell(cell).tint) {
+            case ViewState::Tint::NONE:
+                this->screen->deselectNode(position);
+                break;
+            case ViewState::Tint::SELECTED:
+                this->screen->selectNode(position);
+                break;
+            case ViewState::Tint::HIGHLIGHTED:
+                this->screen->highlightNode(position);
+                break;
+        }
+    }
+    
+    std::vector<const QIcon*> icons;
+    for (int cell : this->delta.iconsChanged) {
+        icons.clear();
+        for (command_handle command : this->next.getCell(cell).commands)
+            icons.push_back(CommandRegistry::getIcon(command));
+        this->screen->setNodeIcons(grid.toPosition(cell), icons);
+    }
+    
+    std::swap(this->shown, this->next);
+}
 
-    if (str == "SHOW") {
-        controller->showAll();
+void Controller::warmView(const Model& model) {
+    if (!this->screen->isVisible())
         return;
+    ViewState view(model.getGrid());
+    view.showModel(model);
+    const GridGeometry& grid = model.getGrid();
+    std::vector<const QIcon*> icons;
+    for (int cell = 0; cell < grid.getCellCount(); cell++) {
+        const ViewState::Cell& next = view.getCell(cell);
+        if (next.commands.empty())
+            continue;
+        icons.clear();
+        for (command_handle command : next.commands)
+            icons.push_back(CommandRegistry::getIcon(command));
+        this->screen->warmNodeIcons(grid.toPosition(cell), icons);
     }
+}
+
+void Controller::startPendingDevices() {
+    for (auto& pending : this->pendingDevices) {
+        try {
+            std::shared_ptr<InputDevice> device = pending.second(this->emitFunction);
+            // Added first, since its worker may emit as soon as it starts
+            this->addInputDevice(device);
+            // Focus came before the device did
+            const bool hasFocus = this->screen->isActiveWindow();
+            if (hasFocus)
+                device->start();
+            device->onFocusChange(hasFocus);
+            DEBUG("Started the " << pending.first);
+        } catch (std::exception& e) {
+            ERROR("Disabled the " << pending.first << ": " << e.what());
+        }
+    }
+    this->pendingDevices.clear();
+}
+
+void Controller::launch(command_handle command) {
+    this->execute(command);
+    this->logStatistics();
+    this->hideAll();
+}
+
+bool Controller::execute(command_handle command) {
+    if (!this->launchGate.admit(command)) {
+        DEBUG("Already launching " << CommandRegistry::getCommand(command));
+        return false;
+    }
+    if (this->dryRun) {
+        DEBUG("Not launching " << CommandRegistry::getCommand(command));
+        return true;
+    }
+    util::executeCommand(CommandRegistry::getCommand(command));
+    this->predictor.recordLaunch(command);
+    this->predictor.saveLater(Config::HISTORY_FILE);
+    return true;
+}
+
+std::string Controller::handleControlRequest(const std::string& request) {
+    auto start = std::chrono::steady_clock::now();
+    std::string error;
+    command_handle command = this->resolve(util::trim(request), error);
+    if (command == NO_COMMAND)
+        return std::string(ControlSocket::REPLY_ERROR) + "\t" + error;
+        
+    if (!this->execute(command))
+        return std::string(ControlSocket::REPLY_ERROR) + "\tAlready launching " +
+               CommandRegistry::getName(command);
+    double elapsed = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start).count();
+    return std::string(ControlSocket::REPLY_OK) + "\t" +
+           CommandRegistry::getName(command) + "\t" +
+           CommandRegistry::getCommand(command) + "\t" + std::to_string(elapsed);
+}
+
+command_handle Controller::resolve(const std::string& request,
+                                   std::string& error) const {
+    // Always against the default tree, whatever is being navigated
+    Model navigator(this->contexts.getDefault(), this->model.getGrid());
     
-    if (str == "BACK") {
-        controller->model = controller->model->selectParent();
-    } else {
-        controller->model = controller->model->select(str);
+    std::vector<Direction> moves;
+    std::stringstream stream(request);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        Direction direction = directionFromString(util::trim(name));
+        if (direction == Direction::INVALID) {
+            moves.clear();
+            break;
+        }
+        moves.push_back(direction);
     }
     
-    auto command = controller->model->getCommand();
-    if (command != nullptr) {
-        util::executeCommand(command->command);
-        controller->hideAll();
+    if (!moves.empty()) {
+        for (Direction direction : moves) {
+            if (!navigator.advance(direction)) {
+                error = "Nothing at " + request;
+                return NO_COMMAND;
+            }
+        }
+        if (navigator.getCommand() == NO_COMMAND)
+            error = request + " does not lead to an application";
+        return navigator.getCommand();
     }
     
-    controller->loadIcons();
+    // Names take precedence over commands, which several
+    // applications may share
+    util::Span<command_handle> commands = navigator.getReachableCommands();
+    for (command_handle command : commands)
+        if (CommandRegistry::getName(command) == request)
+            return command;
+    for (command_handle command : commands)
+        if (CommandRegistry::getCommand(command) == request)
+            return command;
+    error = "No application named " + request;
+    return NO_COMMAND;
+}
+
+void Controller::logStatistics() const {
+    Predictor::Statistics statistics = this->predictor.getStatistics();
+    DEBUG("Prediction hit rate " << statistics.getHitRate() << " ("
+          << statistics.hits << "/" << statistics.predictions << ")");
+    ActionQueue::Statistics queue = this->actions.getStatistics();
+    DEBUG("Action latency " << queue.meanLatencyMs << " ms mean, "
+          << queue.maxLatencyMs << " ms max (" << queue.popped << " handled, "
+          << this->coalesced << " coalesced, " << queue.dropped << " dropped)");
+    UIOverlay::ShowStatistics show = this->screen->getShowStatistics();
+    DEBUG("Hotkey to first frame " << show.meanLatencyMs << " ms mean, "
+          << show.maxLatencyMs << " ms max over " << show.shown << " shows");
+    NodeSprite::CacheStatistics mosaics = NodeSprite::getCacheStatistics();
+    DEBUG("Reused icon mosaics " << mosaics.hits << " times, composed "
+          << mosaics.misses);
+    LaunchGate::Statistics launches = this->launchGate.getStatistics();
+    DEBUG("Launched " << launches.admitted << " commands, suppressed "
+          << launches.suppressed << " repeats");
+    for (auto& device : this->inputDevices) {
+        InputDevice::Statistics deviceStatistics = device->getStatistics();
+        if (deviceStatistics.runningMs == 0.0)
+            continue;
+        DEBUG("The " << device->getName() << " emitted "
+              << deviceStatistics.emitted << " actions at "
+              << deviceStatistics.getEventRate() << " per second using "
+              << deviceStatistics.cpuMs << " ms of CPU ("
+              << deviceStatistics.dropped << " dropped)");
+    }
+}
+
+void Controller::search(const std::string& query) {
+    // Back to the grid, as it was before searching
+    if (query.empty()) {
+        this->searchSession.reset();
+        this->updateView();
+        return;
+    }
     
-    controller->updateView();
+    // Built on first use, and again after the applications change
+    if (this->searchIndex == nullptr)
+        this->searchIndex = std::make_shared<SearchIndex>(
+                                this->contexts.getDefault());
+    if (this->searchSession == nullptr)
+        this->searchSession.reset(new SearchIndex::Session(this->searchIndex));
+    this->searchSession->setQuery(query);
+    
+    this->updateView();
 }
 
-void Controller::updateView() {
-    this->screen->deselectAllNodes();
-    auto path = this->model->getPath();
-    auto last = std::pair<int, int>(0, 0);
-    for (auto it = path->begin(); it != path->end(); it++) {
-        this->screen->selectNode(*it);
-        if (last != std::make_pair(0, 0)) {
-            this->screen->drawPath(last, *it);
-        }
-        last = *it;
+void Controller::editSearch(const Action& action) {
+    std::string query = this->searchSession == nullptr ? std::string() :
+                        this->searchSession->getQuery();
+    if (action.type == Action::Type::SEARCH_TYPE) {
+        query.append(action.text, action.getTextLength());
+    } else if (action.type == Action::Type::SEARCH_ERASE && !query.empty()) {
+        // Drop a whole UTF-8 sequence rather than a single byte
+        do
+            query.pop_back();
+        while (!query.empty() && (query.back() & 0xC0) == 0x80);
+    } else if (action.type == Action::Type::SEARCH_CANCEL) {
+        query.clear();
     }
-    this->screen->highlightNode(*(path->end() - 1));
+    this->search(query);
+}
+
+void Controller::runSearch() {
+    if (this->searchSession == nullptr ||
+            this->searchSession->getResults().empty())
+        return;
+    command_handle command = this->searchSession->getResults()[0];
+    this->searchSession.reset();
+    this->launch(command);
 }
 
 void Controller::hideAll() {
     this->screen->hide();
-    this->model->reset();
-    this->screen->deselectAllNodes();
-    this->screen->resetAllNodeIcons();
+    this->searchSession.reset();
+    this->model.reset();
+    this->predictor.cancel();
+    
+    // The next show starts from the root, so it can be drawn now
+    if (this->prewarm) {
+        this->updateView();
+        this->screen->prewarm();
+    } else {
+        this->next.clear();
+        this->applyView();
+    }
 }
 
-void Controller::showAll() {
-    this->screen->show();
-    this->screen->activateWindow();
+void Controller::showAll(const std::string& windowClass,
+                         std::chrono::steady_clock::time_point requested) {
+    // Updated before showing, so that the first frame is already right.
+    // When prewarmed for the same tree nothing is left to update.
+    this->model.setTree(this->contexts.get(windowClass));
     this->updateView();
-    this->loadIcons();
+    this->screen->present(requested);
 }
 
-void Controller::toggleOverlay() {
+void Controller::toggleOverlay(const std::string& windowClass,
+                               std::chrono::steady_clock::time_point requested) {
     if (this->screen->isVisible())
         this->hideAll();
     else
-        this->showAll();
-}
-
-void Controller::loadIcons() {
-    this->screen->resetAllNodeIcons();
-    std::vector<std::string> directions =
-        * (this->model->getViableDirections());
-    for (auto direction : directions) {
-        auto possibilities = * (this->model->getCommandsInDirection(direction));
-        std::pair<int, int> currentPosition = this->model->getCurrentPosition()
-                                              + getDelta(direction);
-        std::vector<std::shared_ptr<QIcon>> icons;
-        for (auto& possibility : possibilities)
-            icons.push_back(possibility.icon);
-        this->screen->setNodeIcons(currentPosition, icons);
+        this->showAll(windowClass, requested);
+}
+
+void Controller::post(const Action& action) {
+    this->record(action);
+    if (!this->actions.push(action)) {
+        ERROR("Action queue is full, dropped " << action.toString());
+        return;
     }
+    this->scheduleDrain();
+}
+
+void Controller::scheduleDrain() {
+    if (!this->drainScheduled.exchange(true))
+        this->screen->wake();
+}
+
+void Controller::record(const Action& action) {
+    ActionRecorder* recorder = this->recorder.load(std::memory_order_acquire);
+    if (recorder != nullptr)
+        recorder->record(action);
+}
+
+void Controller::addInputDevice(std::shared_ptr<InputDevice> device) {
+    // Recorded as emitted, on the device's worker
+    device->setOutputHandler([&](const Action & action) {
+        this->record(action);
+        this->scheduleDrain();
+    });
+    this->inputDevices.push_back(device);
+}
+
+void Controller::setRecorder(std::unique_ptr<ActionRecorder> recorder) {
+    if (this->recorderStorage != nullptr)
+        throw std::runtime_error("Already recording");
+    this->recorderStorage = std::move(recorder);
+    this->recorder.store(this->recorderStorage.get(), std::memory_order_release);
+}
+
+void Controller::setDryRun(bool dryRun) {
+    this->dryRun = dryRun;
+}
+
+const Model& Controller::getModel() const {
+    return this->model;
+}
+
+void Controller::postToggle(const std::string& windowClass) {
+    {
+        std::lock_guard<std::mutex> lock(this->windowClassMutex);
+        this->windowClass = windowClass;
+        this->toggleRequested = std::chrono::steady_clock::now();
+    }
+    this->post(Action(Action::Type::TOGGLE));
+}
+
+void Controller::drainActions() {
+    // Cleared first, so that anything pushed from here
+    // on schedules another drain
+    this->drainScheduled = false;
+    Action action;
+    Action previous;
+    auto handle = [&]() {
+        if (this->isRedundant(action, previous)) {
+            this->coalesced++;
+            return;
+        }
+        onReceive(action, this);
+        previous = action;
+    };
+    while (this->actions.pop(action))
+        handle();
+        
+    // What workers queued themselves
+    for (auto& device : this->inputDevices) {
+        while (device->takeAction(action))
+            handle();
+    }
+}
+
+bool Controller::isRedundant(const Action& action,
+                             const Action& previous) const {
+    // Showing or hiding twice does nothing the first time didn't
+    if ((action.type == Action::Type::SHOW ||
+            action.type == Action::Type::EXIT) && action == previous)
+        return true;
+        
+    // Once a leaf is reached the overlay closes, so moves made past
+    // it have nothing left to navigate
+    switch (action.type) {
+        case Action::Type::MOVE:
+        case Action::Type::BACK:
+        case Action::Type::SEARCH_TYPE:
+        case Action::Type::SEARCH_ERASE:
+        case Action::Type::SEARCH_CANCEL:
+        case Action::Type::SEARCH_RUN:
+            return !this->screen->isVisible();
+        default:
+            return false;
+    }
+}
+
+std::string Controller::takeWindowClass(
+    std::chrono::steady_clock::time_point& requested) {
+    std::lock_guard<std::mutex> lock(this->windowClassMutex);
+    requested = this->toggleRequested;
+    this->toggleRequested = std::chrono::steady_clock::time_point();
+    std::string windowClass;
+    windowClass.swap(this->windowClass);
+    return windowClass;
 }
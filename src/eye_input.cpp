@@ -17,157 +17,193 @@
 
 #include "eye_input.h"
 
-std::atomic_flag EyeTracker::stopEyeTracking = ATOMIC_FLAG_INIT;
+constexpr int EyeInput::RETRY_DELAY_MS;
 
-void EyeInput::onFocusChange(const bool& hasFocus) {
-    if (hasFocus) {
-        auto runTracker = [](EyeTracker tracker,
-        std::function<void(std::string)> emitter) {
-            tracker.eyeTracking(emitter);
-        };
-        std::thread et(runTracker, tracker, emitFunction);
-        et.detach();
-    } else {
-        tracker.stopTracking();
+namespace {
+    std::shared_ptr<cv::CascadeClassifier> readCascade() {
+        std::shared_ptr<cv::CascadeClassifier> classifier(
+            new cv::CascadeClassifier());
+        if (!classifier->load(
+                    "assets/tracking/haarcascade_eye_tree_eyeglasses.xml"))
+            throw std::runtime_error("Failed to load Haar eye classifier!");
+        return classifier;
     }
 }
 
+EyeInput::~EyeInput() {
+    this->stop();
+}
+
+std::string EyeInput::getName() const {
+    return "eye tracker";
+}
+
+void EyeInput::onFocusChange(const bool& hasFocus) {
+    // Tracking starts and pauses along with the device
+    Q_UNUSED(hasFocus);
+}
+
 void EyeInput::onKeyEvent(QKeyEvent* event) {
 
 }
 
-void EyeTracker::stopTracking() {
-    stopEyeTracking.clear();
+bool EyeInput::hasWorker() const {
+    return true;
+}
+
+void EyeInput::onWorkerStart() {
+    this->tracker.begin();
 }
 
-EyeTracker::EyeTracker() {
-    stopEyeTracking.test_and_set();
+void EyeInput::onWorkerPause() {
+    this->tracker.end();
+}
+
+bool EyeInput::work() {
+    // Cameras drop frames now and then, so the next one is waited for
+    // rather than giving up on tracking until the next restart
+    if (!this->tracker.track())
+        this->waitUntil(std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(RETRY_DELAY_MS));
+    return true;
+}
+
+EyeTracker::EyeTracker() :
+    eye_cascade(loadCascade()),
+    cascade(),
+    capture(),
+    eyeRects(),
+    left_eye_median(StabilizedMedian<int>(4), StabilizedMedian<int>(4)),
+    right_eye_median(StabilizedMedian<int>(4), StabilizedMedian<int>(4)),
+    lastTimestamp(0) {
+}
+
+EyeTracker::cascade_future EyeTracker::loadCascade() {
+    static std::mutex mutex;
+    static cascade_future cascade;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cascade.valid())
+        cascade = std::async(std::launch::async, readCascade).share();
+    return cascade;
+}
+
+void EyeTracker::begin() {
+    // Waits for the cascade if it is still loading
+    this->cascade = this->eye_cascade.get();
+    this->capture.open(-1);
+    if (!this->capture.isOpened())
+        throw std::runtime_error("Error opening video capture!");
+        
     cv::namedWindow("eye_view");
     cv::namedWindow("left_eye");
     cv::namedWindow("right_eye");
     cv::namedWindow("eye_thresholded");
-    
-    if (!eye_cascade.load(
-                "assets/tracking/haarcascade_eye_tree_eyeglasses.xml")) {
-        throw std::runtime_error("Failed to load Haar eye classifier!");
-    }
+    this->lastTimestamp = util::timestamp();
+}
+
+void EyeTracker::end() {
+    this->capture.release();
+    DEBUG("NOT EYE TRACKING");
 }
 
-void EyeTracker::eyeTracking(std::function<void(std::string)> emitter) {
-    cv::VideoCapture capture;
+bool EyeTracker::track() {
     cv::Mat frame;
     cv::Mat frame_gray;
-    capture.open(-1);
-    if (!capture.isOpened()) {
-        DEBUG("Error opening video capture!");
-        stopEyeTracking.test_and_set();
-        return;
-    }
-    auto lastTimestamp = util::timestamp();
     std::vector<cv::Rect> eyes;
-    std::pair<cv::Rect, cv::Rect> eyeRects;
-    std::pair<StabilizedMedian<int>, StabilizedMedian<int>> left_eye_median =
-                std::make_pair(StabilizedMedian<int>(4),
-                               StabilizedMedian<int>(4));
-    std::pair<StabilizedMedian<int>, StabilizedMedian<int>> right_eye_median =
-                std::make_pair(StabilizedMedian<int>(4),
-                               StabilizedMedian<int>(4));
-                               
-    while (stopEyeTracking.test_and_set() && capture.read(frame)) {
-        if (frame.empty()) {
-            DEBUG("No captured frame!");
-            break;
+    if (!this->capture.read(frame))
+        return false;
+    if (frame.empty()) {
+        DEBUG("No captured frame!");
+        return false;
+    }
+    
+    cv::flip(frame, frame, 1);
+    
+    cv::cvtColor(frame, frame_gray, cv::COLOR_BGR2GRAY);
+    cv::equalizeHist(frame_gray, frame_gray);
+    
+    this->cascade->detectMultiScale(frame_gray, eyes,
+                                    1.1, 2, 0 | cv::CASCADE_SCALE_IMAGE,
+                                    cv::Size(30, 30));
+                                    
+    auto crop_eye = [](cv::Rect eye) {
+        return cv::Rect(eye.x + eye.width / 6,
+                        eye.y + eye.height / 4,
+                        (2 * eye.width) / 3,
+                        (1 * eye.height) / 2);
+    };
+    for (cv::Rect eye : eyes) {
+        cv::Point eyeCenter(eye.x + eye.width / 2,
+                            eye.y + eye.height / 2);
+        cv::circle(frame, eyeCenter,
+                   cvRound((eye.width + eye.height) * 0.25),
+                   cv::Scalar(255, 0, 255), 3, 8, 0);
+    }
+    
+    if (eyes.size() == 2 && (eyes[0] & eyes[1]).area() == 0) {
+        if (eyes[0].x < eyes[1].x)
+            eyeRects = std::make_pair(crop_eye(eyes[0]),
+                                      crop_eye(eyes[1]));
+        else
+            eyeRects = std::make_pair(crop_eye(eyes[1]),
+                                      crop_eye(eyes[0]));
+    }
+    
+    cv::imshow("eye_view", frame);
+    if (eyeRects.first.area() != 0 && eyeRects.second.area() != 0) {
+        cv::Mat left_eye = resizeIdeal(frame_gray(eyeRects.first));
+        cv::Mat right_eye = resizeIdeal(frame_gray(eyeRects.second));
+        cv::Point right_eye_loc =
+            computePupilLocationHough(right_eye);
+        cv::Point left_eye_loc =
+            computePupilLocationHough(left_eye);
+        if (right_eye_loc != cv::Point(-1, -1)) {
+            right_eye_median.first.put(right_eye_loc.x);
+            right_eye_median.second.put(right_eye_loc.y);
         }
-        
-        cv::flip(frame, frame, 1);
-        
-        cv::cvtColor(frame, frame_gray, cv::COLOR_BGR2GRAY);
-        cv::equalizeHist(frame_gray, frame_gray);
-        
-        eye_cascade.detectMultiScale(frame_gray, eyes,
-                                     1.1, 2, 0 | cv::CASCADE_SCALE_IMAGE,
-                                     cv::Size(30, 30));
-                                     
-        auto crop_eye = [](cv::Rect eye) {
-            return cv::Rect(eye.x + eye.width / 6,
-                            eye.y + eye.height / 4,
-                            (2 * eye.width) / 3,
-                            (1 * eye.height) / 2);
-        };
-        for (cv::Rect eye : eyes) {
-            cv::Point eyeCenter(eye.x + eye.width / 2,
-                                eye.y + eye.height / 2);
-            cv::circle(frame, eyeCenter,
-                       cvRound((eye.width + eye.height) * 0.25),
-                       cv::Scalar(255, 0, 255), 3, 8, 0);
+        if (left_eye_loc != cv::Point(-1, -1)) {
+            left_eye_median.first.put(left_eye_loc.x);
+            left_eye_median.second.put(left_eye_loc.y);
         }
         
-        if (eyes.size() == 2 && (eyes[0] & eyes[1]).area() == 0) {
-            if (eyes[0].x < eyes[1].x)
-                eyeRects = std::make_pair(crop_eye(eyes[0]),
-                                          crop_eye(eyes[1]));
-            else
-                eyeRects = std::make_pair(crop_eye(eyes[1]),
-                                          crop_eye(eyes[0]));
+        if (left_eye_median.first.getLength() > 0 ||
+                left_eye_median.second.getLength() > 0) {
+            cv::Point left_eye_loc_stabilized =
+                cv::Point(left_eye_median.first.getMedian(),
+                          left_eye_median.second.getMedian());
+            cv::circle(left_eye, left_eye_loc_stabilized,
+                       2,
+                       cv::Scalar(255, 0, 255), 1, 8, 0);
+        }
+        if (right_eye_median.first.getLength() > 0 ||
+                right_eye_median.second.getLength() > 0) {
+            cv::Point right_eye_loc_stabilized =
+                cv::Point(right_eye_median.first.getMedian(),
+                          right_eye_median.second.getMedian());
+            cv::circle(right_eye, right_eye_loc_stabilized,
+                       2,
+                       cv::Scalar(255, 0, 255), 1, 8, 0);
         }
         
-        cv::imshow("eye_view", frame);
-        if (eyeRects.first.area() != 0 && eyeRects.second.area() != 0) {
-            cv::Mat left_eye = resizeIdeal(frame_gray(eyeRects.first));
-            cv::Mat right_eye = resizeIdeal(frame_gray(eyeRects.second));
-            cv::Point right_eye_loc =
-                computePupilLocationHough(right_eye);
-            cv::Point left_eye_loc =
-                computePupilLocationHough(left_eye);
-            if (right_eye_loc != cv::Point(-1, -1)) {
-                right_eye_median.first.put(right_eye_loc.x);
-                right_eye_median.second.put(right_eye_loc.y);
-            }
-            if (left_eye_loc != cv::Point(-1, -1)) {
-                left_eye_median.first.put(left_eye_loc.x);
-                left_eye_median.second.put(left_eye_loc.y);
-            }
-            
-            if (left_eye_median.first.getLength() > 0 ||
-                    left_eye_median.second.getLength() > 0) {
-                cv::Point left_eye_loc_stabilized =
-                    cv::Point(left_eye_median.first.getMedian(),
-                              left_eye_median.second.getMedian());
-                cv::circle(left_eye, left_eye_loc_stabilized,
-                           2,
-                           cv::Scalar(255, 0, 255), 1, 8, 0);
-            }
-            if (right_eye_median.first.getLength() > 0 ||
-                    right_eye_median.second.getLength() > 0) {
-                cv::Point right_eye_loc_stabilized =
-                    cv::Point(right_eye_median.first.getMedian(),
-                              right_eye_median.second.getMedian());
-                cv::circle(right_eye, right_eye_loc_stabilized,
-                           2,
-                           cv::Scalar(255, 0, 255), 1, 8, 0);
-            }
-            
-            if (left_eye_loc != cv::Point(-1, -1)) {
-                cv::circle(left_eye, left_eye_loc,
-                           10,
-                           cv::Scalar(255, 0, 255), 1, 8, 0);
-            }
-            if (right_eye_loc != cv::Point(-1, -1)) {
-                cv::circle(right_eye, right_eye_loc,
-                           10,
-                           cv::Scalar(255, 0, 255), 1, 8, 0);
-            }
-            
-            DEBUG("Left eye at " << left_eye_loc);
-            DEBUG("Right eye at " << right_eye_loc);
-            resizeAndRender(left_eye, "left_eye");
-            resizeAndRender(right_eye, "right_eye");
+        if (left_eye_loc != cv::Point(-1, -1)) {
+            cv::circle(left_eye, left_eye_loc,
+                       10,
+                       cv::Scalar(255, 0, 255), 1, 8, 0);
         }
-        DEBUG("Elapsed milliseconds: " << util::timestamp() - lastTimestamp);
-        lastTimestamp = util::timestamp();
+        if (right_eye_loc != cv::Point(-1, -1)) {
+            cv::circle(right_eye, right_eye_loc,
+                       10,
+                       cv::Scalar(255, 0, 255), 1, 8, 0);
+        }
+        
+        DEBUG("Left eye at " << left_eye_loc);
+        DEBUG("Right eye at " << right_eye_loc);
+        resizeAndRender(left_eye, "left_eye");
+        resizeAndRender(right_eye, "right_eye");
     }
-    capture.release();
-    DEBUG("NOT EYE TRACKING");
+    DEBUG("Elapsed milliseconds: " << util::timestamp() - lastTimestamp);
+    lastTimestamp = util::timestamp();
+    return true;
 }
 
 cv::Point EyeTracker::computePupilLocationHough(cv::Mat eye) {
@@ -0,0 +1,64 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdexcept>
+
+#include "grid.h"
+
+static_assert(Grid<3, 3>::TABLES.neighbours[4][static_cast<int>(Direction::UP)]
+              == 1, "Moving up from the center of a 3x3 grid");
+static_assert(Grid<3, 3>::TABLES.neighbours[0][static_cast<int>(Direction::LEFT)]
+              == -1, "Moving left from a corner leaves the grid");
+              
+namespace {
+    struct RuntimeTables {
+        std::vector<int> neighbours;
+        std::vector<double> centers;
+    };
+}
+
+GridGeometry GridGeometry::create(int width, int height) {
+    if (width < 1 || height < 1)
+        throw std::runtime_error("Grid dimensions must be positive");
+        
+    if (width == 3 && height == 3)
+        return fromGrid<3, 3>();
+    if (width == 5 && height == 5)
+        return fromGrid<5, 5>();
+    if (width == 7 && height == 7)
+        return fromGrid<7, 7>();
+        
+    std::shared_ptr<RuntimeTables> tables = std::make_shared<RuntimeTables>();
+    tables->neighbours.resize(width * height * NUM_DIRECTIONS);
+    tables->centers.resize(width * height * 2);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const int cell = y * width + x;
+            tables->centers[cell * 2] = (x + 0.5) / width;
+            tables->centers[cell * 2 + 1] = (y + 0.5) / height;
+            for (int d = 0; d < NUM_DIRECTIONS; d++) {
+                const int nx = x + DIRECTION_DELTAS[d][0];
+                const int ny = y + DIRECTION_DELTAS[d][1];
+                tables->neighbours[cell * NUM_DIRECTIONS + d] =
+                    (nx >= 0 && nx < width && ny >= 0 && ny < height) ?
+                    ny * width + nx : -1;
+            }
+        }
+    }
+    return GridGeometry(width, height, tables->neighbours.data(),
+                        tables->centers.data(), tables);
+}
@@ -0,0 +1,203 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#include <time.h>
+
+#include "input_device.h"
+
+constexpr size_t InputDevice::OUTPUT_CAPACITY;
+
+namespace {
+    uint64_t toNanoseconds(const timespec& time) {
+        return static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+    }
+    
+    uint64_t getThreadCpuTime() {
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return toNanoseconds(time);
+    }
+    
+    uint64_t getWallTime() {
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return toNanoseconds(time);
+    }
+}
+
+InputDevice::InputDevice(emitter emitFunction, size_t outputCapacity) :
+    emitFunction(emitFunction),
+    mutex(),
+    changed(),
+    state(State::STOPPED),
+    worker(),
+    output(outputCapacity),
+    outputHandler(),
+    cpuTime(0),
+    runningTime(0) {
+}
+
+InputDevice::~InputDevice() {
+    this->stop();
+}
+
+void InputDevice::start() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    const bool ended = this->state == State::FINISHED ||
+                       this->state == State::FAILED;
+    if (this->state == State::RUNNING || (ended && !this->followsFocus()))
+        return;
+    if (ended && this->worker.joinable()) {
+        // The worker set the state on its way out, so it is done
+        lock.unlock();
+        this->worker.join();
+        lock.lock();
+    }
+    this->state = State::RUNNING;
+    if (this->hasWorker() && !this->worker.joinable())
+        this->worker = std::thread(&InputDevice::run, this);
+    this->changed.notify_all();
+}
+
+void InputDevice::pause() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->state != State::RUNNING)
+        return;
+    this->state = State::PAUSED;
+    this->changed.notify_all();
+}
+
+void InputDevice::stop() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->state == State::RUNNING || this->state == State::PAUSED)
+            this->state = State::STOPPED;
+        this->changed.notify_all();
+    }
+    if (this->worker.joinable())
+        this->worker.join();
+}
+
+InputDevice::State InputDevice::getState() const {
+    return this->state;
+}
+
+bool InputDevice::followsFocus() const {
+    return true;
+}
+
+void InputDevice::setOutputHandler(std::function<void(const Action&)>
+                                   handler) {
+    this->outputHandler = handler;
+}
+
+bool InputDevice::takeAction(Action& action) {
+    return this->output.pop(action);
+}
+
+InputDevice::Statistics InputDevice::getStatistics() const {
+    ActionQueue::Statistics output = this->output.getStatistics();
+    return Statistics {output.pushed, output.dropped, this->cpuTime / 1e6,
+                       this->runningTime / 1e6};
+}
+
+bool InputDevice::hasWorker() const {
+    return false;
+}
+
+void InputDevice::onWorkerStart() {
+}
+
+void InputDevice::onWorkerPause() {
+}
+
+bool InputDevice::work() {
+    return false;
+}
+
+bool InputDevice::emit(const Action& action) {
+    if (!this->output.push(action))
+        return false;
+    if (this->outputHandler != nullptr)
+        this->outputHandler(action);
+    return true;
+}
+
+bool InputDevice::emitWaiting(const Action& action) {
+    // The worker is the queue's only producer, so room can't be taken
+    // between checking and pushing. Polling keeps the GUI thread from
+    // having to signal every action it takes.
+    while (this->output.isFull()) {
+        if (!this->waitUntil(std::chrono::steady_clock::now() +
+                             std::chrono::milliseconds(1)))
+            return false;
+    }
+    return this->emit(action);
+}
+
+bool InputDevice::waitUntil(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    return !this->changed.wait_until(lock, deadline, [this]() {
+        return this->state != State::RUNNING;
+    });
+}
+
+void InputDevice::run() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->changed.wait(lock, [this]() {
+            return this->state != State::PAUSED;
+        });
+        if (this->state != State::RUNNING)
+            return;
+        lock.unlock();
+        
+        bool started = false;
+        bool more = true;
+        bool failed = false;
+        try {
+            this->onWorkerStart();
+            started = true;
+            uint64_t cpu = getThreadCpuTime();
+            uint64_t wall = getWallTime();
+            while (more && this->state == State::RUNNING) {
+                more = this->work();
+                uint64_t nextCpu = getThreadCpuTime();
+                uint64_t nextWall = getWallTime();
+                this->cpuTime += nextCpu - cpu;
+                this->runningTime += nextWall - wall;
+                cpu = nextCpu;
+                wall = nextWall;
+            }
+        } catch (std::exception& e) {
+            ERROR("The " << this->getName() << " failed: " << e.what());
+            failed = true;
+        }
+        try {
+            if (started)
+                this->onWorkerPause();
+        } catch (std::exception& e) {
+            ERROR("The " << this->getName() << " failed: " << e.what());
+            failed = true;
+        }
+        
+        lock.lock();
+        if (failed || !more) {
+            this->state = failed ? State::FAILED : State::FINISHED;
+            return;
+        }
+    }
+}
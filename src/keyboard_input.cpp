@@ -19,47 +19,132 @@
 
 #include "config.h"
 
+namespace {
+    // Control characters and the like never go into a query
+    bool isPrintable(const std::string& text) {
+        return !text.empty() && (static_cast<unsigned char>(text[0]) >= ' ') &&
+               text[0] != 0x7F;
+    }
+}
+
+KeyboardInput::KeyboardInput(emitter emitFunction) :
+    InputDevice(emitFunction),
+    keyActions(),
+    characterActions(),
+    searching(false),
+    queryLength(0) {
+    this->readKeys((*(Config::root))["keys"]);
+}
+
+// Bindings are either the name of a key or the character it types
+void KeyboardInput::readKeys(const Json::Value& keys) {
+    for (auto& name : keys.getMemberNames()) {
+        Action action = Action::fromString(name);
+        if (action.type == Action::Type::NONE) {
+            ERROR("Key bound to unknown action " << name);
+            continue;
+        }
+        
+        const Json::Value bindings = keys[name];
+        for (int i = 0; i < bindings.size(); i++) {
+            const std::string binding = bindings[i].asString();
+            auto named = std::find_if(util::keyToString.begin(),
+                                      util::keyToString.end(),
+            [&](const std::pair<const int, std::string> & key) {
+                return key.second == binding;
+            });
+            const QString text = QString::fromStdString(binding);
+            if (named != util::keyToString.end())
+                this->keyActions.emplace(named->first, action);
+            else if (text.size() == 1)
+                this->characterActions.emplace(text.at(0).unicode(), action);
+            else
+                ERROR("Cannot bind " << binding << " to " << name);
+        }
+    }
+}
+
+Action KeyboardInput::getAction(QKeyEvent* event) const {
+    auto byKey = this->keyActions.find(event->key());
+    if (byKey != this->keyActions.end())
+        return byKey->second;
+        
+    const QString text = event->text();
+    if (text.size() == 1) {
+        auto byCharacter = this->characterActions.find(text.at(0).unicode());
+        if (byCharacter != this->characterActions.end())
+            return byCharacter->second;
+    }
+    return Action();
+}
+
+std::string KeyboardInput::getName() const {
+    return "keyboard";
+}
+
 void KeyboardInput::onKeyEvent(QKeyEvent* event) {
-    int key = event->key();
+    const Action action = this->getAction(event);
+    if (this->onSearchKeyEvent(event, action))
+        return;
+        
+    if (action.type == Action::Type::SEARCH) {
+        this->searching = true;
+        return;
+    }
+    if (action.type != Action::Type::NONE) {
+        emitFunction(action);
+        return;
+    }
     
-    auto checkIfKeyMatches = [](QKeyEvent * ev, std::string command,
-    const Json::Value & keys) {
-        const Json::Value listing = keys[command];
-        for (int i = 0; i < keys.size(); i++) {
-            // Either Qt can create a string representation of the keypress
-            // or we need to check it against the key->string map
-            if ((ev->text() != QString() &&
-                    QString::fromStdString(listing[i].asString()) == ev->text()
-                    || (util::keyToString.count(ev->key()) > 0 &&
-                        util::keyToString.at(ev->key()) == listing[i].asString())))
-                return true;
-        }
+    const std::string text = event->text().toStdString();
+    if (isPrintable(text) && text != " ") {
+        this->searching = true;
+        this->type(text);
+    }
+}
+
+// Returns true if the key was used by the search
+bool KeyboardInput::onSearchKeyEvent(QKeyEvent* event, const Action& action) {
+    if (!this->searching)
         return false;
-    };
-    
-    const Json::Value keys = (*(Config::root))["keys"];
-    if (checkIfKeyMatches(event, "l_", keys))
-        emitFunction("l_");
-    else if (checkIfKeyMatches(event, "d_", keys))
-        emitFunction("d_");
-    else if (checkIfKeyMatches(event, "u_", keys))
-        emitFunction("u_");
-    else if (checkIfKeyMatches(event, "r_", keys))
-        emitFunction("r_");
-    else if (checkIfKeyMatches(event, "ul", keys))
-        emitFunction("ul");
-    else if (checkIfKeyMatches(event, "ur", keys))
-        emitFunction("ur");
-    else if (checkIfKeyMatches(event, "dl", keys))
-        emitFunction("dl");
-    else if (checkIfKeyMatches(event, "dr", keys))
-        emitFunction("dr");
-    else if (checkIfKeyMatches(event, "BACK", keys))
-        emitFunction("BACK");
-    else if (checkIfKeyMatches(event, "EXIT", keys))
-        emitFunction("EXIT");
+        
+    if (event->key() == Qt::Key_Return || event->key() == Qt::Key_Enter) {
+        if (this->queryLength > 0)
+            emitFunction(Action(Action::Type::SEARCH_RUN));
+        this->searching = false;
+        this->queryLength = 0;
+    } else if (action.type == Action::Type::EXIT ||
+               (event->key() == Qt::Key_Backspace && this->queryLength == 0)) {
+        this->searching = false;
+        this->queryLength = 0;
+        emitFunction(Action(Action::Type::SEARCH_CANCEL));
+    } else if (event->key() == Qt::Key_Backspace) {
+        this->queryLength--;
+        emitFunction(Action(Action::Type::SEARCH_ERASE));
+    } else {
+        const std::string text = event->text().toStdString();
+        if (isPrintable(text))
+            this->type(text);
+    }
+    return true;
+}
+
+// Types text one UTF-8 character at a time
+void KeyboardInput::type(const std::string& text) {
+    size_t offset = 0;
+    while (offset < text.size()) {
+        size_t length = std::min(Action::getCharacterLength(text[offset]),
+                                 text.size() - offset);
+        emitFunction(Action::character(text.data() + offset, length));
+        offset += length;
+        this->queryLength++;
+    }
 }
 
 void KeyboardInput::onFocusChange(const bool& hasFocus) {
-    
+    // The overlay closed, so whatever was being typed is gone
+    if (!hasFocus) {
+        this->searching = false;
+        this->queryLength = 0;
+    }
 }
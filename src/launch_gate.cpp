@@ -0,0 +1,49 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#include "launch_gate.h"
+
+constexpr std::chrono::milliseconds LaunchGate::WINDOW;
+
+LaunchGate::LaunchGate(std::chrono::milliseconds window) :
+    window(window),
+    inFlight(),
+    statistics({0, 0}) {
+}
+
+bool LaunchGate::admit(command_handle command, clock::time_point now) {
+    // Few launches are ever in flight, so the expired ones are swept
+    // every time rather than kept in order
+    for (auto it = this->inFlight.begin(); it != this->inFlight.end();) {
+        if (now - it->second >= this->window)
+            it = this->inFlight.erase(it);
+        else
+            it++;
+    }
+    
+    if (this->inFlight.count(command) != 0) {
+        this->statistics.suppressed++;
+        return false;
+    }
+    if (this->window.count() > 0)
+        this->inFlight[command] = now;
+    this->statistics.admitted++;
+    return true;
+}
+
+LaunchGate::Statistics LaunchGate::getStatistics() const {
+    return this->statistics;
+}
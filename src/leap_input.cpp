@@ -46,7 +46,7 @@ void LeapListener::onFrame(const Leap::Controller& controller) {
         // If the window was focused and the user actually
         // had their hand in view
         if (focus && hadHand)
-            emitFunction("EXIT");
+            emitFunction(Action(Action::Type::EXIT));
     } else {
         if (only_dominant) {
             // If the user only wants their dominant hand
@@ -79,12 +79,12 @@ void LeapListener::onFrame(const Leap::Controller& controller) {
         isFist = hand.pointables().extended().count() == 0;
         // If they have a fist and the window has focus, exit
         if (isFist && focus)
-            emitFunction("EXIT");
+            emitFunction(Action(Action::Type::EXIT));
         // If we don't have focus, but we didn't have a hand there
         // before and now we do (and we know it's not a fist),
         // then show the window
         if (!focus && !hadHand && !isFist) {
-            emitFunction("SHOW");
+            emitFunction(Action(Action::Type::SHOW));
             delayTimestamp = util::timestamp();
         }
         // Mark the hand as visible
@@ -131,25 +131,10 @@ void LeapListener::handleHandVelocity(const Leap::Hand& hand) {
         
         // If we should regain focus, check events
         if (regainFocus) {
-            std::string gesture = getPose(hand);
-            if (gesture != NOTHING)
-                emitFunction((*(Config::root))[gesture].asString());
-            if (checkEpsilon(angle, 180))
-                emitFunction("l_");
-            else if (checkEpsilon(angle, 270))
-                emitFunction("d_");
-            else if (checkEpsilon(angle, 90))
-                emitFunction("u_");
-            else if (checkEpsilon(angle, 0))
-                emitFunction("r_");
-            else if (checkEpsilon(angle, 135))
-                emitFunction("ul");
-            else if (checkEpsilon(angle, 225))
-                emitFunction("dl");
-            else if (checkEpsilon(angle, 45))
-                emitFunction("ur");
-            else if (checkEpsilon(angle, 315))
-                emitFunction("dr");
+            Action pose = getPose(hand);
+            if (pose.type != Action::Type::NONE)
+                emitFunction(pose);
+            emitFunction(Action::move(getAngleDirection(angle)));
         }
     }
 }
@@ -193,66 +178,29 @@ void LeapListener::handleHandPosition(const Leap::Hand& hand) {
             // Get the angle
             float angle = atan2(diff.y, diff.x);
             angle = (angle > 0 ? angle : (2 * M_PI + angle)) * 360 / (2 * M_PI);
-            int dx, dy;
-            
-            // Determine which sector our hand is in
-            if (checkEpsilon(angle, 180)) {
-                dx = -1;
-                dy = 0;
-            } else if (checkEpsilon(angle, 270)) {
-                dx = 0;
-                dy = -1;
-            } else if (checkEpsilon(angle, 90)) {
-                dx = 0;
-                dy = 1;
-            } else if (checkEpsilon(angle, 0)) {
-                dx = 1;
-                dy = 0;
-            } else if (checkEpsilon(angle, 135)) {
-                dx = -1;
-                dy = 1;
-            } else if (checkEpsilon(angle, 225)) {
-                dx = -1;
-                dy = -1;
-            } else if (checkEpsilon(angle, 45)) {
-                dx = 1;
-                dy = 1;
-            } else if (checkEpsilon(angle, 315)) {
-                dx = 1;
-                dy = -1;
-            }
+            // Leap's y axis points up, the grid's down
+            std::pair<int, int> delta = getDelta(getAngleDirection(angle));
+            int dx = delta.first;
+            int dy = -delta.second;
             DEBUG("(" << dx << ", " << dy << ") Angle " << angle);
             DEBUG("lastPosition " << lastPosition.first << ", " << lastPosition.second);
             
             // Get the difference between this delta and the last delta
             const std::pair<int, int> n_diff(dx - lastPosition.first,
                                              dy - lastPosition.second);
-                                             
-            std::string gesture = getPose(hand);
-            Json::Value poses = (*(Config::root))["poses"];
-            if (gesture != NOTHING) {
-                if (gesture == "BACK") {
+            const Direction direction = getDeltaDirection(
+                                            std::make_pair(n_diff.first, -n_diff.second));
+                                            
+            Action pose = getPose(hand);
+            if (pose.type != Action::Type::NONE) {
+                if (pose.type == Action::Type::BACK) {
                     relativeCenter = currentPosition;
                 }
-                emitFunction(poses[gesture].asString());
+                emitFunction(pose);
             } else if (n_diff == std::make_pair(0, 0))
                 return;
-            else if (n_diff == std::make_pair(-1, 0))
-                emitFunction("l_");
-            else if (n_diff == std::make_pair(0, -1))
-                emitFunction("d_");
-            else if (n_diff == std::make_pair(0, 1))
-                emitFunction("u_");
-            else if (n_diff == std::make_pair(1, 0))
-                emitFunction("r_");
-            else if (n_diff == std::make_pair(-1, 1))
-                emitFunction("ul");
-            else if (n_diff == std::make_pair(-1, -1))
-                emitFunction("dl");
-            else if (n_diff == std::make_pair(1, 1))
-                emitFunction("ur");
-            else if (n_diff == std::make_pair(1, -1))
-                emitFunction("dr");
+            else if (direction != Direction::INVALID)
+                emitFunction(Action::move(direction));
                 
             // Save this delta so we don't repeat the action
             lastPosition = std::make_pair(dx, dy);
@@ -261,13 +209,20 @@ void LeapListener::handleHandPosition(const Leap::Hand& hand) {
     }
 }
 
-std::string LeapListener::getPose(const Leap::Hand& hand) {
+Direction LeapListener::getAngleDirection(float angle) const {
+    // Directions are declared counterclockwise from the right
+    int sector = static_cast<int>(std::floor(angle / 45.0f + 0.5f));
+    return static_cast<Direction>(((sector % NUM_DIRECTIONS) + NUM_DIRECTIONS)
+                                  % NUM_DIRECTIONS);
+}
+
+Action LeapListener::getPose(const Leap::Hand& hand) {
     const float pinchThresh =
         (*(Config::root))["pinch_threshold"].asFloat();
     if (hand.pinchStrength() > pinchThresh)
-        return PINCH;
+        return pinchAction;
     else
-        return NOTHING;
+        return Action();
 }
 
 void LeapInput::onKeyEvent(QKeyEvent* event) {
@@ -19,111 +19,204 @@
 #include "node.h"
 #include "model.h"
 
-std::shared_ptr<Model> Model::select(const std::string& direction) const {
-    if (this->currentNode->hasElement(direction))
-        return std::make_shared<Model>(
-                   Model(this->currentNode->getElement(direction),
-                         getDelta(direction) + this->getCurrentPosition()));
-    else
-        return std::make_shared<Model>(Model(this->currentNode,
-                                             this->getCurrentPosition()));
-}
-
-std::shared_ptr<Model> Model::selectParent() const {
-    if (this->currentNode->parent != nullptr) {
-        std::shared_ptr<Node<util::Command>> parent = this->currentNode->parent;
-        std::pair<int, int> delta;
-        auto unpackedChildren = *(currentNode->parent->unpack());
-        for (auto& map : unpackedChildren) {
-            if (map.second->ID == this->currentNode->ID) {
-                delta = getDelta(map.first);
-                break;
-            }
-        }
-        return std::make_shared<Model>(Model(parent,
-                                             this->getCurrentPosition() - delta));
-    } else
-        return std::make_shared<Model>(Model(this->currentNode,
-                                             this->getCurrentPosition()));
+Model::Model(std::shared_ptr<const command_tree> tree,
+             const GridGeometry& grid) :
+    grid(grid),
+    tree(tree),
+    currentNode(tree->getRoot()),
+    currentPosition(this->getRootPosition()),
+    compressed(false),
+    path(1, this->getRootPosition()) {
+    this->path.reserve(tree->getMaxDepth() + 1);
+}
+
+const Model::command_tree& Model::getTree() const {
+    return *(this->tree);
+}
+
+std::shared_ptr<const Model::command_tree> Model::getSharedTree() const {
+    return this->tree;
+}
+
+void Model::setTree(std::shared_ptr<const command_tree> tree) {
+    this->tree = std::move(tree);
+    this->path.reserve(this->tree->getMaxDepth() + 1);
+    this->reset();
+}
+
+const GridGeometry& Model::getGrid() const {
+    return this->grid;
+}
+
+bool Model::advance(Direction direction) {
+    if (!this->tree->hasChild(this->currentNode, direction))
+        return false;
+    this->step(direction);
+    if (this->compressed)
+        while (this->isForced(this->currentNode))
+            this->step(*(this->getViableDirections().begin()));
+    return true;
+}
+
+bool Model::back() {
+    if (this->tree->getParent(this->currentNode) == NO_NODE)
+        return false;
+    this->stepBack();
+    if (this->compressed)
+        while (this->tree->getParent(this->currentNode) != NO_NODE &&
+                this->isForced(this->currentNode))
+            this->stepBack();
+    return true;
+}
+
+void Model::setCompressed(bool compressed) {
+    this->compressed = compressed;
+}
+
+bool Model::isCompressed() const {
+    return this->compressed;
 }
 
 std::pair<int, int> Model::getRootPosition() const {
-    return {util::GRID_WIDTH / 2, util::GRID_HEIGHT / 2};
+    return this->grid.getRoot();
 }
 
 std::pair<int, int> Model::getCurrentPosition() const {
     return this->currentPosition;
 }
 
-std::shared_ptr<util::Command> Model::getCommand() const {
-    if (this->currentNode->isLeaf())
-        return this->currentNode->data;
-    else
-        return nullptr;
-}
-
-std::shared_ptr<std::vector<util::Command>> Model::getCommandsInDirection(
-const std::string& direction) const {
-    std::shared_ptr<std::vector<util::Command>> commands(new
-            std::vector<util::Command>);
-    // Assuming there exists a child in the intended direction,
-    if (this->currentNode->hasElement(direction)) {
-        // Get all the collapsed possibilities for the node
-        std::shared_ptr <Node<util::Command>::collapsed_children> collapsed =
-            this->currentNode->getCollapsedPossibilities();
-        // And put the commands associated with the leaves in that direction
-        // in a vector
-        for (auto& collapsedChild : (*collapsed)[direction])
-            commands->push_back(*(collapsedChild->data));
-    }
-    return commands;
+command_handle Model::getCommand() const {
+    // An empty root is a leaf without a command
+    if (!this->tree->isLeaf(this->currentNode))
+        return NO_COMMAND;
+    const command_handle* command = this->tree->getData(this->currentNode);
+    return command == nullptr ? NO_COMMAND : *command;
 }
 
-std::shared_ptr<std::vector<std::string>> Model::getViableDirections() const {
-    std::vector<std::string> possibilities;
-    
-    for (auto& map : this->currentNode->children)
-        possibilities.push_back(map.first);
-        
-    return std::make_shared<std::vector<std::string>>(possibilities);
+util::Span<command_handle> Model::getCommandsInDirection(
+    Direction direction) const {
+    // Assuming there exists a child in the intended direction, the commands
+    // associated with the leaves in that direction are its leaf range
+    if (this->tree->hasChild(this->currentNode, direction))
+        return this->tree->getLeaves(this->tree->getChild(this->currentNode,
+                                     direction));
+    return util::Span<command_handle>();
+}
+
+util::Span<command_handle> Model::getReachableCommands() const {
+    return this->tree->getLeaves(this->currentNode);
+}
+
+DirectionSet Model::getViableDirections() const {
+    return this->tree->getChildren(this->currentNode);
 }
 
-std::shared_ptr<util::vec2i> Model::getPath() const {
-    Node<util::Command>::node_ptr curr = this->currentNode;
-    std::pair<int, int> currPos = this->currentPosition;
-    util::vec2i path;
+util::Span<std::pair<int, int>> Model::getPath() const {
+    return util::Span<std::pair<int, int>>(this->path.data(),
+                                           this->path.data() + this->path.size());
+}
+
+void Model::reset() {
+    this->currentNode = this->tree->getRoot();
+    this->currentPosition = this->getRootPosition();
+    this->path.clear();
+    this->path.push_back(this->currentPosition);
+}
+
+std::vector<node_id> Model::insert(command_handle command,
+                                   const util::vec2i& path) {
+    if (path.size() == 0)
+        throw std::runtime_error("Path associated with command "
+                                 + CommandRegistry::getCommand(command)
+                                 + " is empty");
+    std::vector<Direction> moves = this->toMoves(command, path);
+    command_tree& tree = this->getMutableTree();
+    std::vector<node_id> affected = tree.insert(moves, command);
+    this->path.reserve(tree.getMaxDepth() + 1);
+    return affected;
+}
+
+std::vector<node_id> Model::remove(const std::string& command) {
+    // Leaves are stored in DFS order, so the value's index
+    // identifies the node holding it
+    util::Span<command_handle> commands = this->tree->getLeaves(
+            this->tree->getRoot());
+    auto found = std::find_if(commands.begin(), commands.end(),
+    [&](command_handle candidate) {
+        return CommandRegistry::getCommand(candidate) == command;
+    });
+    if (found == commands.end())
+        return std::vector<node_id>();
+    const node_id index = static_cast<node_id>(found - commands.begin());
     
-    // Add the current location down the path
-    path.push_back(currPos);
+    node_id id = 0;
+    while (id < this->tree->size() && this->tree->getNode(id).data != index)
+        id++;
+    std::vector<node_id> affected = this->getMutableTree().remove(id);
+    if (!this->tree->contains(this->currentNode))
+        this->reset();
+    return affected;
+}
+
+node_id Model::getCurrentNode() const {
+    return this->currentNode;
+}
+
+std::vector<Direction> Model::toMoves(command_handle command,
+                                      const util::vec2i& path) const {
+    std::pair<int, int> root = this->getRootPosition();
     
-    // Iterate up the tree
-    while (curr->parent != nullptr) {
-        auto unpackedChildren = *(curr->parent->unpack());
-        // For every child of this node's parents (including the node itself)
-        for (auto map : unpackedChildren) {
-            // If we have found ourselves in the children
-            if (map.second->ID == curr->ID) {
-                // Get the delta to get from the parent to us
-                std::pair<int, int> delta = getDelta(map.first);
-                // Alter our current position by the opposity of the delta
-                currPos = currPos - delta;
-                // Add the current position to the path
-                path.push_back(currPos);
-                // Set our current node to the parent
-                curr = curr->parent;
-            }
-        }
+    // The first node of every path should be the root
+    if (path[0] != root)
+        throw std::runtime_error("Path does not begin with root node!");
+        
+    std::vector<Direction> moves;
+    moves.reserve(path.size());
+    std::pair<int, int> lastPosition = root;
+    int cell = this->grid.toCell(root);
+    // For every node in the path
+    for (auto& node : path) {
+        std::pair<int, int> delta = node - lastPosition;
+        lastPosition = node;
+        if (delta == std::make_pair<int, int>(0, 0))
+            continue;
+            
+        // Get the move between the two nodes
+        Direction direction = getDeltaDirection(delta);
+        if (direction == Direction::INVALID)
+            throw std::runtime_error("Path associated with command "
+                                     + CommandRegistry::getCommand(command)
+                                     + " skips over a node");
+        cell = this->grid.getNeighbour(cell, direction);
+        if (cell == -1)
+            throw std::runtime_error("Path associated with command "
+                                     + CommandRegistry::getCommand(command)
+                                     + " leaves the grid");
+        moves.push_back(direction);
     }
-    
-    // Path is currently in reverse
-    std::reverse(path.begin(), path.end());
-    return std::make_shared<util::vec2i>(path);
+    return moves;
 }
 
-void Model::reset() {
-    auto curr = this->currentNode;
-    while (curr->parent != nullptr)
-        curr = curr->parent;
-    this->currentNode = curr;
-    this->currentPosition = this->getRootPosition();
-}
\ No newline at end of file
+Model::command_tree& Model::getMutableTree() {
+    if (this->tree.use_count() > 1)
+        this->tree = std::make_shared<command_tree>(*(this->tree));
+    // Every tree is created mutable, Model only hands out const references
+    return const_cast<command_tree&>(*(this->tree));
+}
+
+bool Model::isForced(node_id id) const {
+    return this->tree->getChildren(id).size() == 1 &&
+           this->tree->getData(id) == nullptr;
+}
+
+void Model::step(Direction direction) {
+    this->currentNode = this->tree->getChild(this->currentNode, direction);
+    this->currentPosition = getDelta(direction) + this->currentPosition;
+    this->path.push_back(this->currentPosition);
+}
+
+void Model::stepBack() {
+    this->currentNode = this->tree->getParent(this->currentNode);
+    this->path.pop_back();
+    this->currentPosition = this->path.back();
+}
@@ -20,16 +20,22 @@
 
 std::unique_ptr<QPixmap> NodeSprite::unselected = nullptr;
 bool NodeSprite::initialized = false;
+NodeSprite::CacheStatistics NodeSprite::cacheStatistics = {0, 0};
 constexpr double NodeSprite::NODE_WIDTH;
 constexpr double NodeSprite::NODE_HEIGHT;
 constexpr int NodeSprite::NUM_FRAMES;
+constexpr size_t NodeSprite::MOSAIC_CACHE_SIZE;
 
 NodeSprite::NodeSprite(const std::pair<int, int>& position,
-                       const util::WindowProperties& winprops) :
+                       const util::WindowProperties& winprops, double scale) :
     _position(position),
     frame(rand() % NodeSprite::NUM_FRAMES),
     size(),
-    icons() {
+    icons(),
+    animated((*(Config::root))["render_sprites"].asBool()),
+    ellipse(),
+    bounds(),
+    composed() {
     if (!initialized) {
         try {
             NodeSprite::loadAssets();
@@ -39,9 +45,18 @@ NodeSprite::NodeSprite(const std::pair<int, int>& position,
         initialized = true;
     }
     tint = Config::getColor("unselected");
-    this->size = util::toScreenCoords(winprops,
-                                      NodeSprite::getIdealSize(winprops));
     this->current = NodeSprite::unselected->copy();
+    this->place(position, winprops, scale);
+}
+
+void NodeSprite::place(const std::pair<int, int>& position,
+                       const util::WindowProperties& winprops, double scale) {
+    this->_position = position;
+    this->size = util::toScreenCoords(winprops,
+                                      NodeSprite::getIdealSize(winprops, scale));
+    // Mosaics for other icons only depend on the size
+    this->composed.clear();
+    this->layout();
 }
 
 void NodeSprite::loadAssets() {
@@ -58,71 +73,128 @@ void NodeSprite::destroyAssets() {
 void NodeSprite::select() {
     //uint8_t selected[] = {0xFF, 0xDF, 0x00};
     //memcpy(&(this->tint), &selected, 3 * sizeof(int));
-    this->tint = Config::getColor("selected");
+    this->setTint(Config::getColor("selected"));
 }
 
 void NodeSprite::unselect() {
     //uint8_t unselected[] = {255, 255, 255};
     //memcpy(&(this->tint), &unselected, 3 * sizeof(int));
-    this->tint = Config::getColor("unselected");
+    this->setTint(Config::getColor("unselected"));
 }
 
 void NodeSprite::highlight() {
     //uint8_t highlighted[] = {0x1E, 0x90, 0xFF};
     //memcpy(&(this->tint), &highlighted, 3 * sizeof(int));
-    this->tint = Config::getColor("highlighted");
+    this->setTint(Config::getColor("highlighted"));
 }
 
-void NodeSprite::setIcons(const std::vector<std::shared_ptr<QIcon>>& icons) {
+void NodeSprite::setIcons(const std::vector<const QIcon*>& icons) {
     this->icons = icons;
 }
 
+void NodeSprite::warm(const std::vector<const QIcon*>& icons) {
+    this->getComposed(icons, Config::getColor("unselected"));
+}
+
+void NodeSprite::setTint(const QColor& tint) {
+    this->tint = tint;
+}
+
 void NodeSprite::render(const util::WindowProperties& winprops,
                         QPainter& painter) {
-    if ((*(Config::root))["render_sprites"].asBool())
+    if (this->animated)
         util::renderQTImage(painter, current,
                             this->_position.first, this->_position.second,
                             size.first, size.second, &frame, 4, 10);
-    this->drawOverlay(painter);
-    this->drawIcons(painter);
+                            
+    painter.drawPixmap(this->bounds.topLeft(),
+                       this->getComposed(this->icons, this->tint));
+}
+
+const QPixmap& NodeSprite::getComposed(const std::vector<const QIcon*>& icons,
+                                       const QColor& tint) {
+    auto it = std::find_if(this->composed.begin(), this->composed.end(),
+    [&](const Composed & entry) {
+        return entry.icons == icons && entry.tint == tint;
+    });
+    if (it != this->composed.end()) {
+        NodeSprite::cacheStatistics.hits++;
+        this->composed.splice(this->composed.begin(), this->composed, it);
+    } else {
+        NodeSprite::cacheStatistics.misses++;
+        this->composed.push_front({icons, tint, this->compose(icons, tint)});
+        if (this->composed.size() > NodeSprite::MOSAIC_CACHE_SIZE)
+            this->composed.pop_back();
+    }
+    return this->composed.front().pixmap;
+}
+
+NodeSprite::CacheStatistics NodeSprite::getCacheStatistics() {
+    return NodeSprite::cacheStatistics;
+}
+
+QPixmap NodeSprite::compose(const std::vector<const QIcon*>& icons,
+                            const QColor& tint) const {
+    QPixmap pixmap(this->bounds.size());
+    pixmap.fill(Qt::transparent);
+    QPainter painter(&pixmap);
+    painter.translate(-this->bounds.topLeft());
+    this->drawOverlay(painter, tint);
+    this->drawIcons(painter, icons);
+    return pixmap;
+}
+
+QRect NodeSprite::getBounds() const {
+    return this->bounds;
 }
 
 std::pair<double, double> NodeSprite::getIdealSize(const util::WindowProperties&
-        winprops) {
+        winprops, double scale) {
     std::pair<int, int> resolution = {winprops.width, winprops.height};
     
     if (resolution.first > resolution.second)
-        return std::pair<double, double> {NODE_WIDTH, NODE_HEIGHT* ((double) resolution.first / resolution.second)};
+        return std::pair<double, double> {NODE_WIDTH * scale, NODE_HEIGHT * scale * ((double) resolution.first / resolution.second)};
     else
-        return std::pair<double, double> {NODE_WIDTH* ((double) resolution.second / resolution.first), NODE_HEIGHT};
+        return std::pair<double, double> {NODE_WIDTH * scale * ((double) resolution.second / resolution.first), NODE_HEIGHT * scale};
 }
 
-void NodeSprite::drawOverlay(QPainter& painter) {
+void NodeSprite::drawOverlay(QPainter& painter, const QColor& tint) const {
     painter.setBrush(tint);
-    QRectF idealRect = QRectF(this->_position.first, this->_position.second,
-                              size.first, size.second);
-    painter.drawEllipse(idealRect);
+    painter.drawEllipse(this->ellipse);
 }
 
-void NodeSprite::drawIcons(QPainter& painter) {
-    auto renderIcon =
-    [&](std::shared_ptr<QIcon> icon, int x, int y, int width, int height) {
-        util::renderQTImage(painter, icon->pixmap(QSize(width, height)), x, y, width,
-                            height, NULL, 1, 1);
-    };
+void NodeSprite::drawIcons(QPainter& painter,
+                           const std::vector<const QIcon*>& icons) const {
+    std::vector<QRect> mosaic = this->getMosaic(icons.size());
+    for (size_t i = 0; i < mosaic.size(); i++) {
+        const QRect& cell = mosaic[i];
+        util::renderQTImage(painter, icons[i]->pixmap(cell.size()), cell.x(),
+                            cell.y(), cell.width(), cell.height(), NULL, 1, 1);
+    }
+}
+
+void NodeSprite::layout() {
+    this->ellipse = QRectF(this->_position.first, this->_position.second,
+                           size.first, size.second);
+    this->bounds = QRect(this->_position.first, this->_position.second,
+                         size.first, size.second).adjusted(-1, -1, 1, 1);
+}
+
+std::vector<QRect> NodeSprite::getMosaic(size_t count) const {
+    std::vector<QRect> mosaic;
     
     // Avoid expensive stitching operations if we can
-    if (icons.size() == 1) {
-        renderIcon(icons[0], this->_position.first, this->_position.second, size.first,
-                   size.second);
-        return;
+    if (count == 1) {
+        mosaic.push_back(QRect(this->_position.first, this->_position.second,
+                               size.first, size.second));
+        return mosaic;
     }
     
-    if (icons.size() <= 1)
-        return;
+    if (count <= 1)
+        return mosaic;
         
     // Resizes icons to fit in area
-    int numIcons = icons.size();
+    int numIcons = count;
     int order = ((int) ceil(log2((double) numIcons)));
     int dx, dy, offset_x, offset_y;
     
@@ -144,14 +216,13 @@ void NodeSprite::drawIcons(QPainter& painter) {
         offset_y = size_y / (order + 1);
     }
     
-    int index = 0;
     for (int y = offset_y; y < size.first; y += dy) {
         for (int x = offset_x; x < size.second; x += dx) {
-            if (index < numIcons) {
-                renderIcon(icons[index], this->_position.first + x,
-                           this->_position.second + y, size_x, size_y);
-            }
-            index += 1;
+            if (mosaic.size() == count)
+                return mosaic;
+            mosaic.push_back(QRect(this->_position.first + x,
+                                   this->_position.second + y, size_x, size_y));
         }
     }
-}
\ No newline at end of file
+    return mosaic;
+}
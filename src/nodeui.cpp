@@ -24,36 +24,214 @@
 #include "model.h"
 #include "controller.h"
 #include "hotkey.h"
+#include "trie_image.h"
+#include "path_assigner.h"
+#include "predictor.h"
+#include "context_set.h"
+#include "action_recorder.h"
+#include "replay_input.h"
+#include "control_server.h"
 
 
+// Parses the application list and writes the compiled images
+// of the default tree and of every window class with a layout
+ContextSet compileApplications(const GridGeometry& grid) {
+    std::shared_ptr<std::vector<Model::command_position>>
+    apps = Config::readApplications();
+    
+    // Applications without a path get one, shortest for the most launched
+    Predictor predictor(false);
+    predictor.load(Config::HISTORY_FILE);
+    size_t assigned = PathAssigner::assign(*apps, grid,
+    [&](command_handle command) {
+        return predictor.getScore(CommandRegistry::getCommand(command));
+    });
+    DEBUG("Assigned paths to " << assigned << " applications");
+    
+    Model model(*apps, grid);
+    ContextSet contexts(model.getSharedTree());
+    for (auto& context : Config::readContexts(*apps))
+        contexts.add(context.first, Model(context.second, grid).getSharedTree());
+    DEBUG("Read layouts for " << contexts.size() << " window classes");
+    
+    try {
+        TrieImage::compile(model, Config::APP_IMAGE_FILE, Config::APP_FILE);
+        contexts.compile(Config::CONTEXT_IMAGE_DIR, Config::APP_FILE, grid);
+    } catch (std::runtime_error& e) {
+        ERROR(e.what());
+    }
+    return contexts;
+}
+
+// Maps the compiled application images, only falling back to the JSON
+// when an image is stale
+ContextSet loadApplications(const GridGeometry& grid) {
+    // No new .desktop files can have shown up unless one of the
+    // directories changed since the image was written
+    bool scanned = false;
+    const Json::Value desktopFiles = (*(Config::root))["desktop_file_dirs"];
+    for (int i = 0; i < desktopFiles.size(); i++) {
+        std::string directory = desktopFiles[i].asString();
+        if (TrieImage::modifiedSince(directory, Config::APP_IMAGE_FILE)) {
+            Config::updateApplicationList(directory);
+            scanned = true;
+        }
+    }
+    
+    ContextSet contexts(TrieImage::load(Config::APP_IMAGE_FILE, Config::APP_FILE,
+                                        grid));
+    if (contexts.getDefault() == nullptr ||
+            !contexts.load(Config::CONTEXT_IMAGE_DIR, Config::APP_FILE, grid)) {
+        DEBUG("Compiling " << Config::APP_FILE);
+        return compileApplications(grid);
+    }
+    
+    if (scanned)
+        TrieImage::touch(Config::APP_IMAGE_FILE);
+    return contexts;
+}
+
 Controller* createUIOverlay() {
     Config::readConfig();
-    const Json::Value desktopFiles = (*(Config::root))["desktop_file_dirs"];
-    for (int i = 0; i < desktopFiles.size(); i++)
-        Config::updateApplicationList(desktopFiles[i].asString().c_str());
-    std::shared_ptr<std::vector<std::pair<util::Command, util::vec2i_ptr>>>
-    apps = Config::readApplications();
     
     // TODO: Fix odd memory corruption that happens around here on rare occasions
-    std::shared_ptr<UIOverlay> screen(new UIOverlay);
-    std::shared_ptr<Model> model(new Model(*apps));
-    Controller* controller = new Controller(model, screen);
+    GridGeometry grid = Config::getGrid();
+    std::shared_ptr<UIOverlay> screen(new UIOverlay(grid));
+    ContextSet contexts = loadApplications(grid);
+    Model model(contexts.getDefault(), grid);
+    model.setCompressed((*(Config::root))["compress_paths"].asBool());
+    Controller* controller = new Controller(model, contexts, screen);
     screen->start();
     return controller;
 }
 
+// Runs on the hotkey listener's thread
 void onHotkeyPress(Controller* controller) {
-    controller->toggleOverlay();
+    controller->postToggle(HotKey::getFocusedWindowClass());
+}
+
+// Harness for reproducing input without the hardware
+struct ReplayOptions {
+    // Records every action into this file
+    std::string recordFile;
+    // Replays this file, or generated input if stressRate is set
+    std::string replayFile;
+    double speed = 1.0;
+    double stressRate = 0.0;
+    size_t stressCount = 10000;
+    
+    bool isReplaying() const {
+        return !replayFile.empty() || stressRate > 0.0;
+    }
+};
+
+ReplayOptions readReplayOptions(int argc, char* argv[]) {
+    ReplayOptions options;
+    for (int i = 1; i < argc; i += 2) {
+        const std::string option = argv[i];
+        if (i + 1 == argc)
+            throw std::runtime_error("Missing a value for " + option);
+        const std::string value = argv[i + 1];
+        if (option == "--record")
+            options.recordFile = value;
+        else if (option == "--replay")
+            options.replayFile = value;
+        else if (option == "--speed")
+            options.speed = std::stod(value);
+        else if (option == "--stress")
+            options.stressRate = std::stod(value);
+        else if (option == "--count")
+            options.stressCount = std::stoul(value);
+        else
+            throw std::runtime_error("Unknown option " + option);
+    }
+    return options;
+}
+
+// Replays until the input runs out, then quits. Nothing is launched.
+std::shared_ptr<ReplayInput> startReplay(const ReplayOptions& options,
+        Controller* controller, QApplication* app) {
+    std::vector<ActionRecorder::Entry> entries = options.replayFile.empty() ?
+            ReplayInput::generate(controller->getModel(), options.stressCount,
+                                  options.stressRate) :
+            ActionRecorder::load(options.replayFile);
+    controller->setDryRun(true);
+    
+    std::shared_ptr<ReplayInput> replay(new ReplayInput([controller](
+    const Action & action) {
+        controller->post(action);
+    }, std::move(entries), options.speed, [app]() {
+        QMetaObject::invokeMethod(app, "quit", Qt::QueuedConnection);
+    }));
+    controller->addInputDevice(replay);
+    replay->start();
+    return replay;
+}
+
+// Lets scripts launch applications through this instance
+std::unique_ptr<ControlServer> startControlServer(Controller* controller) {
+    const Json::Value& root = *(Config::root);
+    if (!root["control_socket_enabled"].asBool())
+        return nullptr;
+    std::string path = root["control_socket"].asString();
+    if (path.empty())
+        path = ControlSocket::getDefaultPath();
+        
+    try {
+        return std::unique_ptr<ControlServer>(new ControlServer(path,
+        [controller](const std::string & request) {
+            return controller->handleControlRequest(request);
+        }));
+    } catch (std::runtime_error& e) {
+        ERROR(e.what());
+        return nullptr;
+    }
 }
 
 int main(int argc, char* argv[]) {
     QApplication app(argc, argv);
+    
+    // Rebuild the application image offline, without showing anything
+    if (argc > 1 && std::string(argv[1]) == "--compile") {
+        Config::readConfig();
+        compileApplications(Config::getGrid());
+        return 0;
+    }
+    
+    ReplayOptions options;
+    try {
+        options = readReplayOptions(argc, argv);
+    } catch (std::exception& e) {
+        ERROR(e.what());
+        std::cerr << "Usage: " << argv[0] << " [--compile] [--record FILE] "
+                  << "[--replay FILE] [--speed FACTOR] [--stress RATE] "
+                  << "[--count N]" << std::endl;
+        return 1;
+    }
+    
     Controller* controller = createUIOverlay();
+    if (!options.recordFile.empty())
+        controller->setRecorder(std::unique_ptr<ActionRecorder>(
+                                    new ActionRecorder(options.recordFile)));
+                                    
+    std::shared_ptr<ReplayInput> replay;
+    if (options.isReplaying())
+        replay = startReplay(options, controller, &app);
+    std::unique_ptr<ControlServer> server = startControlServer(controller);
+        
     int hotkey = XStringToKeysym((*(Config::root))["hotkey"].
                                  asString().c_str());
     int modifier = (*(Config::root))["hotkey_modifier"].asInt();
     HotKey::configureHotkey(hotkey, modifier, onHotkeyPress, controller);
     int result = app.exec();
+    
+    if (replay != nullptr) {
+        InputDevice::Statistics statistics = replay->getStatistics();
+        DEBUG("Replay throughput " << statistics.getEventRate()
+              << " actions per second, " << statistics.dropped << " dropped");
+        controller->logStatistics();
+    }
+    server.reset();
     UIOverlay::terminate();
     HotKey::dispose();
     delete controller;
@@ -0,0 +1,126 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "control_socket.h"
+
+// Sends launch requests to a running NodeUI and prints its replies. Requests
+// are taken from the arguments, or from stdin, one per line, if there are
+// none. Exits with 1 if any of them failed and 2 if NodeUI isn't running.
+int main(int argc, char* argv[]) {
+    std::string path = ControlSocket::getDefaultPath();
+    std::vector<std::string> requests;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-s" && i + 1 < argc)
+            path = argv[++i];
+        else
+            requests.push_back(argv[i]);
+    }
+    if (requests.empty()) {
+        std::string line;
+        while (std::getline(std::cin, line))
+            requests.push_back(line);
+    }
+    
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server == -1 || connect(server, reinterpret_cast<sockaddr*>(&address),
+                                sizeof(address)) == -1) {
+        std::cerr << "NodeUI is not listening on " << path << std::endl;
+        return 2;
+    }
+    
+    // Replies are read while the requests are still being sent, since
+    // NodeUI stops reading from a client that doesn't take its replies
+    std::string batch;
+    for (auto& request : requests)
+        batch += request + '\n';
+    if (batch.empty())
+        shutdown(server, SHUT_WR);
+        
+    int result = 0;
+    size_t answered = 0;
+    std::string replies;
+    const std::string failed = std::string(ControlSocket::REPLY_ERROR) + '\t';
+    auto printReplies = [&]() {
+        size_t start = 0;
+        size_t end;
+        while ((end = replies.find('\n', start)) != std::string::npos) {
+            std::string reply = replies.substr(start, end - start);
+            if (reply.compare(0, failed.size(), failed) == 0)
+                result = 1;
+            std::cout << reply << std::endl;
+            answered++;
+            start = end + 1;
+        }
+        replies.erase(0, start);
+    };
+    
+    size_t sent = 0;
+    char buffer[1024];
+    while (true) {
+        pollfd descriptor = {server, POLLIN, 0};
+        if (sent < batch.size())
+            descriptor.events |= POLLOUT;
+        if (poll(&descriptor, 1, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        
+        if (descriptor.revents & POLLOUT) {
+            ssize_t written = send(server, batch.data() + sent, batch.size() - sent,
+                                   MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (written == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+                break;
+            if (written > 0)
+                sent += written;
+            if (sent == batch.size())
+                shutdown(server, SHUT_WR);
+        }
+        
+        if (descriptor.revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t received = recv(server, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                continue;
+            if (received <= 0)
+                break;
+            replies.append(buffer, received);
+            printReplies();
+        }
+    }
+    close(server);
+    
+    if (answered < requests.size()) {
+        std::cerr << "NodeUI answered " << answered << " of " << requests.size()
+                  << " requests" << std::endl;
+        result = 1;
+    }
+    return result;
+}
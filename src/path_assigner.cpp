@@ -0,0 +1,160 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <deque>
+#include <queue>
+#include <tuple>
+
+#include "path_assigner.h"
+
+namespace {
+    // A free spot in the tree where a new node could be attached
+    struct Slot {
+        node_id parent;
+        Direction direction;
+        int cell;
+        uint32_t depth;
+        uint32_t order;
+        
+        // Orders the queue shallowest first, then first come first served
+        bool operator<(const Slot& other) const {
+            if (depth != other.depth)
+                return depth > other.depth;
+            return order > other.order;
+        }
+    };
+    
+    util::vec2i_ptr buildPath(const Tree<uint8_t>& occupied, node_id leaf,
+                              const std::pair<int, int>& root) {
+        std::vector<Direction> moves;
+        for (node_id node = leaf; occupied.getParent(node) != NO_NODE;
+                node = occupied.getParent(node))
+            moves.push_back(occupied.getIncomingDirection(node));
+            
+        util::vec2i_ptr path(new util::vec2i);
+        path->reserve(moves.size() + 1);
+        path->push_back(root);
+        for (auto it = moves.rbegin(); it != moves.rend(); it++)
+            path->push_back(path->back() + getDelta(*it));
+        return path;
+    }
+}
+
+size_t PathAssigner::assign(std::vector<Model::command_position>& commands,
+                            const GridGeometry& grid,
+                            const frequency_function& frequency) {
+    const std::pair<int, int> root = grid.getRoot();
+    
+    // Mark every node used by a hand-assigned path. Nodes holding
+    // a command can't be extended without making it unreachable.
+    Tree<uint8_t> occupied;
+    std::vector<size_t> pathless;
+    for (size_t i = 0; i < commands.size(); i++) {
+        const util::vec2i& path = *(commands[i].second);
+        if (path.size() == 0) {
+            pathless.push_back(i);
+            continue;
+        }
+        
+        node_id node = occupied.getRoot();
+        std::pair<int, int> lastPosition = root;
+        for (auto& position : path) {
+            Direction direction = getDeltaDirection(position - lastPosition);
+            lastPosition = position;
+            if (direction != Direction::INVALID && grid.contains(position))
+                node = occupied.addChild(node, direction);
+        }
+        occupied.setData(node, 1);
+    }
+    
+    if (pathless.empty())
+        return 0;
+        
+    // Most frequently launched first, ties keep their order in the file.
+    // Every command counts as launched once, so unused ones still
+    // compete for room evenly.
+    std::vector<double> scores(commands.size());
+    double remainingScore = 0.0;
+    for (size_t index : pathless) {
+        scores[index] = frequency(commands[index].first) + 1.0;
+        remainingScore += scores[index];
+    }
+    std::stable_sort(pathless.begin(), pathless.end(),
+    [&](size_t l, size_t r) {
+        return scores[l] > scores[r];
+    });
+    
+    // Collect free slots under every node that doesn't hold a command
+    std::priority_queue<Slot> slots;
+    uint32_t order = 0;
+    std::deque<std::tuple<node_id, int, uint32_t>> frontier;
+    frontier.push_back(std::make_tuple(occupied.getRoot(), grid.toCell(root), 0));
+    while (!frontier.empty()) {
+        node_id node;
+        int cell;
+        uint32_t depth;
+        std::tie(node, cell, depth) = frontier.front();
+        frontier.pop_front();
+        if (occupied.getData(node) != nullptr)
+            continue;
+        for (int d = 0; d < NUM_DIRECTIONS; d++) {
+            Direction direction = static_cast<Direction>(d);
+            int neighbour = grid.getNeighbour(cell, direction);
+            if (neighbour == -1)
+                continue;
+            node_id child = occupied.getChild(node, direction);
+            if (child == NO_NODE)
+                slots.push({node, direction, neighbour, depth + 1, order++});
+            else
+                frontier.push_back(std::make_tuple(child, neighbour, depth + 1));
+        }
+    }
+    
+    // Grids this small can't branch, so growing them never makes room
+    const bool canGrow = grid.getCellCount() >= 3;
+    
+    size_t next = 0;
+    while (next < pathless.size() && !slots.empty()) {
+        Slot slot = slots.top();
+        slots.pop();
+        
+        // The shallowest slot goes to the most frequent command left if it
+        // carries at least its share of the launches, or if there is room
+        // for everyone anyway. Otherwise it becomes a branch, pushing the
+        // rarer commands one move deeper.
+        const double score = scores[pathless[next]];
+        const size_t remaining = pathless.size() - next;
+        if (!canGrow || slots.size() + 1 >= remaining ||
+                score * (slots.size() + 1) >= remainingScore) {
+            node_id leaf = occupied.addChild(slot.parent, slot.direction);
+            occupied.setData(leaf, 1);
+            commands[pathless[next++]].second = buildPath(occupied, leaf, root);
+            remainingScore -= score;
+        } else {
+            node_id branch = occupied.addChild(slot.parent, slot.direction);
+            for (int d = 0; d < NUM_DIRECTIONS; d++) {
+                Direction direction = static_cast<Direction>(d);
+                int neighbour = grid.getNeighbour(slot.cell, direction);
+                if (neighbour != -1)
+                    slots.push({branch, direction, neighbour, slot.depth + 1, order++});
+            }
+        }
+    }
+    
+    return next;
+}
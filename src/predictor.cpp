@@ -0,0 +1,279 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <sstream>
+
+#include <QTimer>
+
+#include <json/reader.h>
+#include <json/writer.h>
+
+#include "config.h"
+#include "predictor.h"
+
+constexpr size_t Predictor::MAX_CANDIDATES;
+constexpr size_t Predictor::MAX_PREDICTIONS;
+constexpr double Predictor::HALF_LIFE_MS;
+
+namespace {
+    // Don't read the same binary ahead more than once a minute
+    constexpr uint64_t REWARM_DELAY_MS = 60 * 1000;
+    
+    // Resolves the executable that a command line would run
+    std::string findExecutable(const std::string& command) {
+        std::istringstream tokens(command);
+        std::string program;
+        tokens >> program;
+        if (program.empty() || program.find('/') != std::string::npos)
+            return program;
+            
+        const char* path = getenv("PATH");
+        std::istringstream directories(path == nullptr ? "" : path);
+        std::string directory;
+        while (std::getline(directories, directory, ':')) {
+            std::string candidate = directory + "/" + program;
+            if (access(candidate.c_str(), X_OK) == 0)
+                return candidate;
+        }
+        return std::string();
+    }
+}
+
+Predictor::Predictor(bool warming) :
+    history(),
+    outstanding(),
+    warmer(),
+    predictions(0),
+    hits(0),
+    binariesWarmed(0),
+    viewsWarmed(0),
+    queue(),
+    recentlyWarmed(),
+    pendingHistory(),
+    pendingFile(),
+    stopping(false) {
+    if (warming)
+        this->worker = std::thread(&Predictor::warmBinaries, this);
+}
+
+Predictor::~Predictor() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+void Predictor::load(const std::string& filename) {
+    Json::Value root;
+    Json::Reader reader;
+    if (!reader.parse(Config::readFile(filename), root))
+        return;
+        
+    const Json::Value launches = root["launches"];
+    for (int i = 0; i < launches.size(); i++) {
+        const Json::Value entry = launches[i];
+        history[entry["command"].asString()] = {
+            entry["score"].asDouble(), entry["timestamp"].asUInt64()
+        };
+    }
+}
+
+void Predictor::save(const std::string& filename) const {
+    writeHistory(filename, history);
+}
+
+void Predictor::saveLater(const std::string& filename) {
+    if (!worker.joinable()) {
+        save(filename);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        pendingHistory.reset(new history_map(history));
+        pendingFile = filename;
+    }
+    queueCondition.notify_one();
+}
+
+void Predictor::writeHistory(const std::string& filename,
+                             const history_map& history) {
+    Json::Value root;
+    int index = 0;
+    for (auto& entry : history) {
+        root["launches"][index]["command"] = entry.first;
+        root["launches"][index]["score"] = entry.second.score;
+        root["launches"][index]["timestamp"] =
+            Json::Value::UInt64(entry.second.timestamp);
+        index++;
+    }
+    Json::FastWriter writer;
+    Config::writeFile(filename, writer.write(root));
+}
+
+void Predictor::recordLaunch(command_handle command) {
+    if (!outstanding.empty()) {
+        predictions++;
+        if (std::find(outstanding.begin(), outstanding.end(), command) !=
+                outstanding.end())
+            hits++;
+        outstanding.clear();
+    }
+    
+    const std::string& commandLine = CommandRegistry::getCommand(command);
+    const uint64_t now = util::timestamp();
+    auto found = history.find(commandLine);
+    if (found == history.end())
+        history[commandLine] = {1.0, now};
+    else
+        found->second = {decay(found->second, now) + 1.0, now};
+}
+
+void Predictor::predict(const Model& model) {
+    util::Span<command_handle> reachable = model.getReachableCommands();
+    if (reachable.empty() || reachable.size() > MAX_CANDIDATES)
+        return;
+        
+    const uint64_t now = util::timestamp();
+    std::vector<std::pair<double, command_handle>> ranked;
+    ranked.reserve(reachable.size());
+    for (command_handle command : reachable) {
+        auto found = history.find(CommandRegistry::getCommand(command));
+        double score = found == history.end() ? 0.0 : decay(found->second, now);
+        ranked.push_back(std::make_pair(score, command));
+    }
+    
+    size_t count = std::min(MAX_PREDICTIONS, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+                      [](const std::pair<double, command_handle>& l,
+    const std::pair<double, command_handle>& r) {
+        return l.first > r.first;
+    });
+    
+    outstanding.clear();
+    for (size_t i = 0; i < count; i++) {
+        const command_handle command = ranked[i].second;
+        outstanding.push_back(command);
+        warmBinary(CommandRegistry::getCommand(command));
+    }
+    if (count > 0)
+        warmView(model, ranked[0].second);
+}
+
+void Predictor::cancel() {
+    outstanding.clear();
+}
+
+double Predictor::getScore(const std::string& command) const {
+    auto found = history.find(command);
+    if (found == history.end())
+        return 0.0;
+    return decay(found->second, util::timestamp());
+}
+
+void Predictor::setViewWarmer(view_warmer warmer) {
+    this->warmer = warmer;
+}
+
+Predictor::Statistics Predictor::getStatistics() const {
+    return {predictions, hits, predictions - hits, binariesWarmed.load(),
+            viewsWarmed};
+}
+
+double Predictor::decay(const Entry& entry, uint64_t now) const {
+    double age = now > entry.timestamp ? now - entry.timestamp : 0;
+    return entry.score * std::pow(0.5, age / HALF_LIFE_MS);
+}
+
+void Predictor::warmView(const Model& model, command_handle likeliest) {
+    if (!this->warmer)
+        return;
+    Model next = model;
+    for (Direction direction : model.getViableDirections()) {
+        util::Span<command_handle> commands = model.getCommandsInDirection(direction);
+        if (std::find(commands.begin(), commands.end(), likeliest) != commands.end()) {
+            next.advance(direction);
+            break;
+        }
+    }
+    if (next.getCurrentNode() == model.getCurrentNode())
+        return;
+        
+    // Drawing only happens on the GUI thread, so the view is warmed
+    // once the current event has been handled and the move is on screen
+    QTimer::singleShot(0, [this, next]() {
+        this->warmer(next);
+        viewsWarmed++;
+    });
+}
+
+void Predictor::warmBinary(const std::string& command) {
+    if (!worker.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(command);
+    }
+    queueCondition.notify_one();
+}
+
+void Predictor::warmBinaries() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true) {
+        queueCondition.wait(lock, [this]() {
+            return stopping || !queue.empty() || pendingHistory != nullptr;
+        });
+        
+        // Launches are never lost to a write that was still pending
+        if (pendingHistory != nullptr) {
+            std::unique_ptr<history_map> snapshot = std::move(pendingHistory);
+            std::string filename = pendingFile;
+            lock.unlock();
+            writeHistory(filename, *snapshot);
+            lock.lock();
+            continue;
+        }
+        if (stopping)
+            return;
+            
+        std::string command = queue.front();
+        queue.pop_front();
+        
+        const uint64_t now = util::timestamp();
+        auto found = recentlyWarmed.find(command);
+        if (found != recentlyWarmed.end() &&
+                now - found->second < REWARM_DELAY_MS)
+            continue;
+        recentlyWarmed[command] = now;
+        
+        lock.unlock();
+        std::string executable = findExecutable(command);
+        int fd = executable.empty() ? -1 : open(executable.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            close(fd);
+            binariesWarmed++;
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,129 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "replay_input.h"
+
+ReplayInput::ReplayInput(emitter emitFunction,
+                         std::vector<ActionRecorder::Entry> entries,
+                         double speed, std::function<void()> onFinished) :
+    // Room for a burst of replayed input
+    InputDevice(emitFunction, ActionQueue::CAPACITY),
+    entries(std::move(entries)),
+    speed(speed),
+    onFinished(onFinished),
+    next(0),
+    origin() {
+}
+
+ReplayInput::~ReplayInput() {
+    this->stop();
+}
+
+std::string ReplayInput::getName() const {
+    return "replay";
+}
+
+void ReplayInput::onKeyEvent(QKeyEvent* event) {
+    Q_UNUSED(event);
+}
+
+void ReplayInput::onFocusChange(const bool& hasFocus) {
+    Q_UNUSED(hasFocus);
+}
+
+bool ReplayInput::followsFocus() const {
+    return false;
+}
+
+bool ReplayInput::hasWorker() const {
+    return true;
+}
+
+void ReplayInput::onWorkerStart() {
+    // Resuming carries on at the recorded pace from where it left off
+    uint64_t elapsed = this->next == 0 ? 0 : this->entries[this->next - 1].time;
+    this->origin = std::chrono::steady_clock::now() - std::chrono::microseconds(
+                       static_cast<uint64_t>(elapsed / std::max(this->speed, 1e-9)));
+}
+
+bool ReplayInput::work() {
+    if (this->next == this->entries.size()) {
+        DEBUG("Replayed " << this->entries.size() << " actions");
+        if (this->onFinished != nullptr)
+            this->onFinished();
+        return false;
+    }
+    
+    const ActionRecorder::Entry& entry = this->entries[this->next];
+    if (this->speed > 0.0 &&
+            !this->waitUntil(this->origin + std::chrono::microseconds(
+                                 static_cast<uint64_t>(entry.time / this->speed))))
+        return true;
+    // Dropping any of it would make the replay diverge from the recording
+    if (!this->emitWaiting(entry.action))
+        return true;
+    this->next++;
+    return true;
+}
+
+std::vector<ActionRecorder::Entry> ReplayInput::generate(const Model& model,
+        size_t count, double rate, unsigned seed) {
+    std::vector<ActionRecorder::Entry> entries;
+    entries.reserve(count + 1);
+    const uint64_t interval = rate > 0.0 ? static_cast<uint64_t>(1e6 / rate) : 0;
+    uint64_t time = 0;
+    auto emit = [&](const Action & action) {
+        entries.push_back(ActionRecorder::Entry {time, action});
+        time += interval;
+    };
+    
+    // Mirrors what the controller's model does with every action
+    Model navigator(model);
+    navigator.reset();
+    std::mt19937 random(seed);
+    emit(Action(Action::Type::SHOW));
+    while (entries.size() < count) {
+        Direction moves[NUM_DIRECTIONS];
+        size_t numMoves = 0;
+        for (Direction direction : navigator.getViableDirections()) {
+            Model probe(navigator);
+            probe.advance(direction);
+            if (probe.getCommand() == NO_COMMAND)
+                moves[numMoves++] = direction;
+        }
+        
+        const bool canGoBack = navigator.getPath().size() > 1;
+        if (numMoves > 0 && (!canGoBack || random() % 4 != 0)) {
+            Direction direction = moves[random() % numMoves];
+            navigator.advance(direction);
+            emit(Action::move(direction));
+        } else if (canGoBack) {
+            navigator.back();
+            emit(Action(Action::Type::BACK));
+        } else {
+            // Every move from the root launches something
+            navigator.reset();
+            emit(Action(Action::Type::EXIT));
+            emit(Action(Action::Type::SHOW));
+        }
+    }
+    entries.resize(count);
+    return entries;
+}
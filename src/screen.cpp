@@ -23,11 +23,25 @@
 #include "util.h"
 #include "screen.h"
 
-UIOverlay::UIOverlay(QWidget* parent) :
+UIOverlay::UIOverlay(const GridGeometry& grid, QWidget* parent) :
     QWidget(parent),
     properties {0, 0},
+    grid(grid),
     pathOverlay(),
-    nodesprites() {
+    nodesprites(),
+    centers(),
+    paths(),
+    pathsBounds(),
+    pathsValid(true),
+    pathPen(Config::getColor("line")),
+    backingStore(),
+    backingStoreValid(false),
+    damage(),
+    animated((*(Config::root))["render_sprites"].asBool()),
+    frameTimer(0),
+    firstFramePending(false),
+    showRequested(),
+    showStatistics {0, 0.0, 0.0, 0.0} {
     
     srand(time(NULL));
     
@@ -46,22 +60,8 @@ UIOverlay::UIOverlay(QWidget* parent) :
     this->setAttribute(Qt::WA_TranslucentBackground);
     this->setWindowFlags(Qt::FramelessWindowHint);
     
-    std::pair<double, double> node_size = NodeSprite::getIdealSize(
-            this->properties);
-    for (double i = 0.50; i < HORIZONTAL_NODE_NUM; i++) {
-        for (double j = 0.50; j < VERTICAL_NODE_NUM; j++) {
-            std::pair<double, double> spacing = {1.0 / HORIZONTAL_NODE_NUM, 1.0 / VERTICAL_NODE_NUM};
-            std::pair<int, int> position = util::toScreenCoords(this->properties, {
-                spacing.first * i - node_size.first / 2.0,
-                spacing.second * j - node_size.second / 2.0
-            });
-            
-            std::pair<int, int> index = {(int) i, (int) j};
-            std::shared_ptr<NodeSprite> sprite = std::shared_ptr<NodeSprite>(new NodeSprite(
-                    position, this->properties));
-            this->nodesprites.insert(std::make_pair(index, sprite));
-        }
-    }
+    this->pathPen.setWidth(PATH_WIDTH);
+    this->layoutScene();
     this->setFocusPolicy(Qt::StrongFocus);
 }
 
@@ -70,8 +70,17 @@ UIOverlay::~UIOverlay() {
 }
 
 void UIOverlay::timerEvent(QTimerEvent* event) {
-    Q_UNUSED(event);
-    repaint();
+    if (event->timerId() != this->frameTimer)
+        return;
+    this->killTimer(this->frameTimer);
+    this->frameTimer = 0;
+    
+    // Only the sprites move, the paths between them are redrawn
+    // wherever they cross one
+    if (this->animated && this->isVisible()) {
+        for (auto& nodesprite : this->nodesprites)
+            this->invalidate(nodesprite.second->getBounds());
+    }
 }
 
 void UIOverlay::keyPressEvent(QKeyEvent* event) {
@@ -80,17 +89,47 @@ void UIOverlay::keyPressEvent(QKeyEvent* event) {
 }
 
 void UIOverlay::paintEvent(QPaintEvent* event) {
-    Q_UNUSED(event);
-    QPainter qp(this);
-    
     try {
-        this->render(qp);
+        this->renderBackingStore();
+        QPainter qp(this);
+        qp.setCompositionMode(QPainter::CompositionMode_Source);
+        qp.drawPixmap(event->rect(), this->backingStore, event->rect());
     } catch (...) {
         std::exception_ptr p = std::current_exception();
         std::clog << (p ? p.__cxa_exception_type() -> name() : "null") << std::endl;
         
         UIOverlay::terminate();
     }
+    
+    if (this->firstFramePending) {
+        this->firstFramePending = false;
+        double latency = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - this->showRequested).count();
+        ShowStatistics& statistics = this->showStatistics;
+        statistics.shown++;
+        statistics.meanLatencyMs += (latency - statistics.meanLatencyMs) /
+                                    statistics.shown;
+        statistics.maxLatencyMs = std::max(statistics.maxLatencyMs, latency);
+        statistics.lastLatencyMs = latency;
+        DEBUG("First frame painted " << latency << " ms after the hotkey");
+        
+        // Handled once this frame is out of the way
+        QCoreApplication::postEvent(this, new QEvent(SHOWN_EVENT));
+    }
+    
+    // Each frame asks for the next, so animation stops with the painting
+    // once the overlay is hidden
+    if (this->animated)
+        this->requestFrame();
+}
+
+void UIOverlay::resizeEvent(QResizeEvent* event) {
+    if (event->size().width() == this->properties.width &&
+            event->size().height() == this->properties.height)
+        return;
+    this->properties.width = event->size().width();
+    this->properties.height = event->size().height();
+    this->layoutScene();
 }
 
 void UIOverlay::closeEvent(QCloseEvent* event) {
@@ -106,6 +145,13 @@ void UIOverlay::changeEvent(QEvent* event) {
     }
 }
 
+void UIOverlay::customEvent(QEvent* event) {
+    if (event->type() == WAKE_EVENT && this->wakeHandler != nullptr)
+        this->wakeHandler();
+    else if (event->type() == SHOWN_EVENT && this->shownHandler != nullptr)
+        this->shownHandler();
+}
+
 void UIOverlay::focusInEvent(QFocusEvent * event) {
     focusHandler(true);
 }
@@ -123,8 +169,38 @@ void UIOverlay::setFocusHandler(
     this->focusHandler = handler;
 }
 
+void UIOverlay::setWakeHandler(std::function<void()> handler) {
+    this->wakeHandler = handler;
+}
+
+void UIOverlay::wake() {
+    // Posting is thread safe, and Qt takes ownership of the event
+    QCoreApplication::postEvent(this, new QEvent(WAKE_EVENT));
+}
+
+void UIOverlay::setShownHandler(std::function<void()> handler) {
+    this->shownHandler = handler;
+}
+
 void UIOverlay::start() {
-    timerID = startTimer(1000 / UIOverlay::FRAMERATE);
+    this->update();
+}
+
+void UIOverlay::prewarm() {
+    // Forces the native window to be created now rather than when mapped
+    this->winId();
+    this->renderBackingStore();
+}
+
+void UIOverlay::present(std::chrono::steady_clock::time_point requested) {
+    this->showRequested = requested;
+    this->firstFramePending = requested != std::chrono::steady_clock::time_point();
+    this->show();
+    this->activateWindow();
+}
+
+UIOverlay::ShowStatistics UIOverlay::getShowStatistics() const {
+    return this->showStatistics;
 }
 
 void UIOverlay::terminate() {
@@ -134,62 +210,173 @@ void UIOverlay::terminate() {
 
 void UIOverlay::selectNode(const std::pair<int, int>& position) {
     this->nodesprites.at(position)->select();
+    this->markDirty(position);
 }
 
 void UIOverlay::deselectNode(const std::pair<int, int>& position) {
     this->nodesprites.at(position)->unselect();
+    this->markDirty(position);
 }
 
 void UIOverlay::highlightNode(const std::pair<int, int>& position) {
     this->nodesprites.at(position)->highlight();
+    this->markDirty(position);
 }
 
 void UIOverlay::drawPath(const std::pair<int, int>& startPosition,
                          const std::pair<int, int>& endPosition) {
-    this->pathOverlay.insert(std::make_pair(startPosition, endPosition));
+    const coord_pair path = std::make_pair(startPosition, endPosition);
+    if (this->pathOverlay.insert(path).second) {
+        this->pathsValid = false;
+        this->invalidate(this->getPathBounds(path));
+    }
+}
+
+void UIOverlay::erasePath(const std::pair<int, int>& startPosition,
+                          const std::pair<int, int>& endPosition) {
+    const coord_pair path = std::make_pair(startPosition, endPosition);
+    if (this->pathOverlay.erase(path) > 0) {
+        this->pathsValid = false;
+        this->invalidate(this->getPathBounds(path));
+    }
 }
 
 void UIOverlay::setNodeIcons(const std::pair<int, int>& position,
-                             const std::vector<std::shared_ptr<QIcon>>& icons) {
+                             const std::vector<const QIcon*>& icons) {
     this->nodesprites.at(position)->setIcons(icons);
+    this->markDirty(position);
+}
+
+void UIOverlay::warmNodeIcons(const std::pair<int, int>& position,
+                              const std::vector<const QIcon*>& icons) {
+    this->nodesprites.at(position)->warm(icons);
 }
 
 void UIOverlay::deselectAllNodes() {
-    for (auto nodesprite : this->nodesprites)
+    for (auto& nodesprite : this->nodesprites) {
         nodesprite.second->unselect();
+        this->markDirty(nodesprite.first);
+    }
+    for (auto& path : this->pathOverlay)
+        this->invalidate(this->getPathBounds(path));
     this->pathOverlay.clear();
+    this->pathsValid = false;
 }
 
 void UIOverlay::resetAllNodeIcons() {
-    std::vector<std::shared_ptr<QIcon>> empty;
-    for (auto nodesprite : this->nodesprites)
+    std::vector<const QIcon*> empty;
+    for (auto& nodesprite : this->nodesprites) {
         nodesprite.second->setIcons(empty);
+        this->markDirty(nodesprite.first);
+    }
+}
+
+void UIOverlay::markDirty(const std::pair<int, int>& position) {
+    this->invalidate(this->nodesprites.at(position)->getBounds());
+}
+
+void UIOverlay::invalidate(const QRect& rect) {
+    this->damage += rect;
+    // Does nothing while hidden, showing paints everything anyway
+    this->update(rect);
+}
+
+void UIOverlay::requestFrame() {
+    if (this->frameTimer == 0)
+        this->frameTimer = this->startTimer(1000 / UIOverlay::FRAMERATE);
+}
+
+QPoint UIOverlay::getCenter(const std::pair<int, int>& position) const {
+    return this->centers[this->grid.toCell(position)];
+}
+
+QRect UIOverlay::getPathBounds(const coord_pair& path) const {
+    // Wide enough for the pen and its antialiased edge
+    const int margin = PATH_WIDTH / 2 + 2;
+    return QRect(this->getCenter(path.first),
+                 this->getCenter(path.second)).normalized().adjusted(
+               -margin, -margin, margin, margin);
 }
 
 std::pair<int, int> UIOverlay::getResolution() {
     return std::make_pair(this->properties.width, this->properties.height);
 }
 
-void UIOverlay::render(QPainter& painter) {
-    for (auto& map : this->nodesprites)
-        map.second->render(this->properties, painter);
+void UIOverlay::layoutScene() {
+    std::pair<double, double> node_size = NodeSprite::getIdealSize(
+            this->properties, this->grid.getNodeScale());
+    this->centers.resize(this->grid.getCellCount());
+    for (int cell = 0; cell < this->grid.getCellCount(); cell++) {
+        std::pair<double, double> center = this->grid.getCenter(cell);
+        std::pair<int, int> position = util::toScreenCoords(this->properties, {
+            center.first - node_size.first / 2.0,
+            center.second - node_size.second / 2.0
+        });
         
-    for (auto& pos : pathOverlay) {
-        const auto nsp0 = this->nodesprites.at(pos.first);
-        const auto nsp1 = this->nodesprites.at(pos.second);
-        const std::pair<int, int> offset0 = util::toScreenCoords(this->properties,
-                                            nsp0->getIdealSize(this->properties));
-        const std::pair<int, int> offset1 = util::toScreenCoords(this->properties,
-                                            nsp1->getIdealSize(this->properties));
-        const std::pair<int, int> position0 = nsp0->_position + std::make_pair(
-                offset0.first / 2, offset0.second / 2);
-        const std::pair<int, int> position1 = nsp1->_position + std::make_pair(
-                offset1.first / 2, offset1.second / 2);
+        std::pair<int, int> index = this->grid.toPosition(cell);
+        auto found = this->nodesprites.find(index);
+        if (found == this->nodesprites.end()) {
+            std::shared_ptr<NodeSprite> sprite = std::shared_ptr<NodeSprite>(new NodeSprite(
+                    position, this->properties, this->grid.getNodeScale()));
+            found = this->nodesprites.insert(std::make_pair(index, sprite)).first;
+        } else {
+            found->second->place(position, this->properties, this->grid.getNodeScale());
+        }
+        
+        const QRect bounds = found->second->getBounds();
+        this->centers[cell] = QPoint(bounds.left() + bounds.width() / 2,
+                                     bounds.top() + bounds.height() / 2);
+    }
+    this->pathsValid = false;
+    this->backingStoreValid = false;
+    this->update();
+}
+
+void UIOverlay::layoutPaths() {
+    this->paths = QPainterPath();
+    this->pathsBounds = QRect();
+    for (auto& path : this->pathOverlay) {
+        this->paths.moveTo(this->getCenter(path.first));
+        this->paths.lineTo(this->getCenter(path.second));
+        this->pathsBounds = this->pathsBounds.united(this->getPathBounds(path));
+    }
+    this->pathsValid = true;
+}
+
+void UIOverlay::renderBackingStore() {
+    if (this->backingStore.size() != this->size()) {
+        this->backingStore = QPixmap(this->size());
+        this->backingStoreValid = false;
+    }
+    
+    if (!this->backingStoreValid) {
+        this->backingStore.fill(Qt::transparent);
+        QPainter painter(&this->backingStore);
+        this->render(painter, QRegion(this->rect()));
+    } else if (!this->damage.isEmpty()) {
+        QPainter painter(&this->backingStore);
+        painter.setClipRegion(this->damage);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.fillRect(this->damage.boundingRect(), Qt::transparent);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        this->render(painter, this->damage);
+    }
+    this->backingStoreValid = true;
+    this->damage = QRegion();
+}
+
+void UIOverlay::render(QPainter& painter, const QRegion& region) {
+    for (auto& map : this->nodesprites) {
+        if (region.intersects(map.second->getBounds()))
+            map.second->render(this->properties, painter);
+    }
+    
+    if (!this->pathsValid)
+        this->layoutPaths();
+    if (!this->pathOverlay.empty() && region.intersects(this->pathsBounds)) {
         painter.setRenderHint(QPainter::Antialiasing, true);
-        QPen pen(Config::getColor("line"));
-        pen.setWidth(20);
-        painter.setPen(pen);
-        painter.drawLine(QPoint(position0.first, position0.second),
-                         QPoint(position1.first, position1.second));
+        painter.setPen(this->pathPen);
+        painter.setBrush(Qt::NoBrush);
+        painter.drawPath(this->paths);
     }
 }
@@ -0,0 +1,299 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cctype>
+
+#include "search_index.h"
+
+constexpr size_t SearchIndex::MAX_RESULTS;
+constexpr uint32_t SearchIndex::ALPHABET_SIZE;
+constexpr uint32_t SearchIndex::KEY_COUNT;
+
+namespace {
+    const char SEPARATOR = '\n';
+    const uint32_t NO_ENTRY = 0xFFFFFFFF;
+    
+    std::string toLower(const std::string& text) {
+        std::string lower(text);
+        for (char& c : lower)
+            if (c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+        return lower;
+    }
+    
+    bool isWordCharacter(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c < 0;
+    }
+    
+    // Visits the start of every trigram that doesn't straddle the separator
+    template <class F>
+    void forEachTrigram(const std::string& text, size_t begin, size_t end,
+                        F visit) {
+        for (size_t i = begin; i + 3 <= end; i++)
+            if (text[i] != SEPARATOR && text[i + 1] != SEPARATOR &&
+                    text[i + 2] != SEPARATOR)
+                visit(i);
+    }
+}
+
+SearchIndex::SearchIndex(tree_ptr tree) :
+    tree(tree),
+    commands(tree->getLeaves(tree->getRoot())),
+    offsets(KEY_COUNT + 1, 0) {
+    this->texts.reserve(this->commands.size());
+    this->nameLengths.reserve(this->commands.size());
+    for (command_handle command : this->commands) {
+        const std::string& name = CommandRegistry::getName(command);
+        this->texts.push_back(toLower(name) + SEPARATOR +
+                              toLower(CommandRegistry::getCommand(command)));
+        this->nameLengths.push_back(name.size());
+    }
+    
+    // Visits every key of an entry once
+    std::vector<uint32_t> lastEntry;
+    auto forEachKey = [&](uint32_t id, auto visit) {
+        auto visitOnce = [&](uint32_t key) {
+            if (lastEntry[key] != id) {
+                lastEntry[key] = id;
+                visit(key);
+            }
+        };
+        const std::string& text = this->texts[id];
+        forEachTrigram(text, 0, text.size(), [&](size_t i) {
+            visitOnce(getTrigramKey(&text[i]));
+        });
+        for (size_t i = 0; i < text.size(); i++) {
+            if (!isWordCharacter(text[i]) ||
+                    (i > 0 && isWordCharacter(text[i - 1])))
+                continue;
+            visitOnce(getPrefixKey(&text[i], 1));
+            if (i + 1 < text.size() && isWordCharacter(text[i + 1]))
+                visitOnce(getPrefixKey(&text[i], 2));
+        }
+    };
+    
+    // Count the entries of every key, then fill the posting lists in
+    // entry order so that each of them comes out sorted
+    lastEntry.assign(KEY_COUNT, NO_ENTRY);
+    for (uint32_t id = 0; id < this->texts.size(); id++)
+        forEachKey(id, [&](uint32_t key) {
+        this->offsets[key + 1]++;
+    });
+    for (size_t i = 1; i < this->offsets.size(); i++)
+        this->offsets[i] += this->offsets[i - 1];
+        
+    this->postings.resize(this->offsets.back());
+    std::vector<uint32_t> next(this->offsets.begin(), this->offsets.end() - 1);
+    lastEntry.assign(KEY_COUNT, NO_ENTRY);
+    for (uint32_t id = 0; id < this->texts.size(); id++)
+        forEachKey(id, [&](uint32_t key) {
+        this->postings[next[key]++] = id;
+    });
+}
+
+size_t SearchIndex::size() const {
+    return this->commands.size();
+}
+
+const SearchIndex::tree_ptr& SearchIndex::getTree() const {
+    return this->tree;
+}
+
+uint32_t SearchIndex::getSymbol(char c) {
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 1;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 27;
+    // Everything else shares a few symbols, at worst making
+    // a query match a few more entries than it should
+    if (c < 0)
+        return ALPHABET_SIZE - 1;
+    return 0;
+}
+
+uint32_t SearchIndex::getTrigramKey(const char* text) {
+    return (getSymbol(text[0]) * ALPHABET_SIZE + getSymbol(text[1])) *
+           ALPHABET_SIZE + getSymbol(text[2]);
+}
+
+// Prefixes get the keys after the trigrams
+uint32_t SearchIndex::getPrefixKey(const char* text, size_t length) {
+    const uint32_t trigrams = ALPHABET_SIZE * ALPHABET_SIZE * ALPHABET_SIZE;
+    if (length == 1)
+        return trigrams + getSymbol(text[0]);
+    return trigrams + ALPHABET_SIZE + getSymbol(text[0]) * ALPHABET_SIZE +
+           getSymbol(text[1]);
+}
+
+util::Span<uint32_t> SearchIndex::getPostings(uint32_t key) const {
+    return util::Span<uint32_t>(this->postings.data() + this->offsets[key],
+                                this->postings.data() + this->offsets[key + 1]);
+}
+
+SearchIndex::Session::Session(std::shared_ptr<const SearchIndex> index) :
+    index(index),
+    query(),
+    queryTrigrams(),
+    counts(index->size(), 0),
+    listed(index->size(), false),
+    touched(),
+    results() {
+    this->results.reserve(MAX_RESULTS);
+}
+
+void SearchIndex::Session::setQuery(const std::string& query) {
+    const std::string lower = toLower(query);
+    
+    // Only trigrams overlapping the part after the common prefix change
+    size_t common = 0;
+    while (common < lower.size() && common < this->query.size() &&
+            lower[common] == this->query[common])
+        common++;
+    const size_t first = common >= 2 ? common - 2 : 0;
+    forEachTrigram(this->query, first, this->query.size(), [&](size_t i) {
+        this->removeTrigram(getTrigramKey(&this->query[i]));
+    });
+    forEachTrigram(lower, first, lower.size(), [&](size_t i) {
+        this->addTrigram(getTrigramKey(&lower[i]));
+    });
+    this->query = lower;
+    
+    this->results.clear();
+    if (this->query.empty())
+        return;
+    if (this->query.size() < 3)
+        this->rankPrefixes();
+    else
+        this->rankTrigrams();
+}
+
+const std::string& SearchIndex::Session::getQuery() const {
+    return this->query;
+}
+
+const std::vector<command_handle>&
+SearchIndex::Session::getResults() const {
+    return this->results;
+}
+
+void SearchIndex::Session::addTrigram(uint32_t trigram) {
+    for (auto& entry : this->queryTrigrams) {
+        if (entry.first == trigram) {
+            entry.second++;
+            return;
+        }
+    }
+    this->queryTrigrams.push_back(std::make_pair(trigram, 1));
+    
+    for (uint32_t id : this->index->getPostings(trigram)) {
+        this->counts[id]++;
+        if (!this->listed[id]) {
+            this->listed[id] = true;
+            this->touched.push_back(id);
+        }
+    }
+}
+
+void SearchIndex::Session::removeTrigram(uint32_t trigram) {
+    auto entry = std::find_if(this->queryTrigrams.begin(),
+                              this->queryTrigrams.end(),
+    [&](const std::pair<uint32_t, int>& candidate) {
+        return candidate.first == trigram;
+    });
+    if (entry == this->queryTrigrams.end() || --entry->second > 0)
+        return;
+    this->queryTrigrams.erase(entry);
+    
+    for (uint32_t id : this->index->getPostings(trigram))
+        this->counts[id]--;
+}
+
+void SearchIndex::Session::rankPrefixes() {
+    const std::string& query = this->query;
+    util::Span<uint32_t> matches = this->index->getPostings(
+                                       getPrefixKey(query.data(), query.size()));
+                                       
+    // Names that start with the query beat words inside
+    // names, which beat words in the command line
+    std::vector<std::pair<int, uint32_t>> scored;
+    scored.reserve(matches.size());
+    for (uint32_t id : matches) {
+        const std::string& text = this->index->texts[id];
+        int score = 1;
+        if (text.compare(0, query.size(), query) == 0)
+            score = 3;
+        else if (text.find(query) < this->index->nameLengths[id])
+            score = 2;
+        scored.push_back(std::make_pair(score, id));
+    }
+    this->keepBest(scored);
+}
+
+void SearchIndex::Session::rankTrigrams() {
+    // Allow a third of the trigrams to be missing, roughly one typo
+    // for every nine characters typed
+    const int total = this->queryTrigrams.size();
+    const int required = total - total / 3;
+    
+    std::vector<std::pair<int, uint32_t>> scored;
+    size_t kept = 0;
+    for (uint32_t id : this->touched) {
+        const int count = this->counts[id];
+        if (count == 0) {
+            this->listed[id] = false;
+            continue;
+        }
+        this->touched[kept++] = id;
+        if (count < required)
+            continue;
+            
+        // Exact matches outrank fuzzy ones, most of all at the start
+        // of the name and least of all in the command line
+        int score = count * 2;
+        size_t position = this->index->texts[id].find(this->query);
+        if (position == 0)
+            score += total * 3;
+        else if (position < this->index->nameLengths[id])
+            score += total * 2;
+        else if (position != std::string::npos)
+            score += total;
+        scored.push_back(std::make_pair(score, id));
+    }
+    this->touched.resize(kept);
+    this->keepBest(scored);
+}
+
+void SearchIndex::Session::keepBest(
+    std::vector<std::pair<int, uint32_t>>& scored) {
+    // Ties go to the shorter name, then to the earlier entry
+    const std::vector<uint32_t>& lengths = this->index->nameLengths;
+    auto better = [&](const std::pair<int, uint32_t>& l,
+    const std::pair<int, uint32_t>& r) {
+        if (l.first != r.first)
+            return l.first > r.first;
+        if (lengths[l.second] != lengths[r.second])
+            return lengths[l.second] < lengths[r.second];
+        return l.second < r.second;
+    };
+    
+    size_t count = std::min(MAX_RESULTS, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + count, scored.end(),
+                      better);
+    for (size_t i = 0; i < count; i++)
+        this->results.push_back(this->index->commands[scored[i].second]);
+}
@@ -0,0 +1,294 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+#include "config.h"
+#include "trie_image.h"
+
+constexpr uint32_t TrieImage::VERSION;
+
+namespace {
+
+    static_assert(std::is_trivially_copyable<Node>::value,
+                  "Nodes must be trivially copyable to be mapped");
+                  
+    const char MAGIC[4] = {'N', 'U', 'I', 'T'};
+    
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+    
+    struct CommandRecord {
+        StringRef name;
+        StringRef command;
+        StringRef icon;
+    };
+    
+    // Everything is stored in native byte order, the image is a cache
+    // rather than an interchange format
+    struct ImageHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t nodeSize;
+        uint32_t nodeCount;
+        uint32_t commandCount;
+        uint32_t maxDepth;
+        uint32_t gridWidth;
+        uint32_t gridHeight;
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        uint64_t sourceHash;
+        uint64_t nodesOffset;
+        uint64_t commandsOffset;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+    
+    // 64-bit FNV-1a
+    uint64_t hashContents(const std::string& contents) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c : contents) {
+            hash ^= c;
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+    
+    int64_t getMtime(const struct stat& info) {
+        return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000LL +
+               info.st_mtim.tv_nsec;
+    }
+    
+    uint64_t align(uint64_t offset) {
+        return (offset + 7) & ~static_cast<uint64_t>(7);
+    }
+    
+    void padTo(std::ofstream& out, uint64_t offset) {
+        while (static_cast<uint64_t>(out.tellp()) < offset)
+            out.put('\0');
+    }
+    
+    bool isStale(const ImageHeader& header, const std::string& sourceFile) {
+        struct stat sourceInfo;
+        if (stat(sourceFile.c_str(), &sourceInfo) != 0)
+            return true;
+        if (static_cast<uint64_t>(sourceInfo.st_size) != header.sourceSize)
+            return true;
+        if (getMtime(sourceInfo) == header.sourceMtime)
+            return false;
+        // The file was touched, but it may not have actually changed
+        return hashContents(Config::readFile(sourceFile)) != header.sourceHash;
+    }
+    
+    // True if count items of the given size fit between offset and the
+    // end of the image, written so that a corrupt header can't overflow
+    bool fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t length) {
+        return offset <= length && count <= (length - offset) / size;
+    }
+    
+    bool isValid(const ImageHeader& header, uint64_t length) {
+        if (std::string(header.magic, 4) != std::string(MAGIC, 4) ||
+                header.version != TrieImage::VERSION ||
+                header.nodeSize != sizeof(Node) || header.nodeCount == 0)
+            return false;
+        // Nodes and records are read in place
+        if (header.nodesOffset % alignof(Node) != 0 ||
+                header.commandsOffset % alignof(CommandRecord) != 0)
+            return false;
+        return fits(header.nodesOffset, header.nodeCount, sizeof(Node), length) &&
+               fits(header.commandsOffset, header.commandCount,
+                    sizeof(CommandRecord), length) &&
+               fits(header.stringsOffset, header.stringsSize, 1, length);
+    }
+    
+    bool isValid(const Node* nodes, node_id id, const ImageHeader& header) {
+        const Node& node = nodes[id];
+        for (int i = 0; i < NUM_DIRECTIONS; i++) {
+            const node_id child = node.children[i];
+            const bool masked = (node.childMask & (1 << i)) != 0;
+            if (masked != (child != NO_NODE))
+                return false;
+            // Children point back, so going back never leaves the arena
+            if (child != NO_NODE && (child >= header.nodeCount || child == 0 ||
+                                     nodes[child].parent != id))
+                return false;
+        }
+        
+        // Only the root and nodes left over from pruning have no parent,
+        // and the latter are blank
+        if (node.parent == NO_NODE) {
+            if (id != 0 && (node.childMask != 0 || node.data != NO_NODE))
+                return false;
+        } else if (id == 0 || node.parent >= header.nodeCount) {
+            return false;
+        }
+        return (node.data == NO_NODE || node.data < header.commandCount) &&
+               node.leafBegin <= node.leafEnd &&
+               node.leafEnd <= header.commandCount;
+    }
+}
+
+void TrieImage::compile(const Model& model,
+                        const std::string& imageFile,
+                        const std::string& sourceFile) {
+    const Model::command_tree& tree = model.getTree();
+    struct stat sourceInfo;
+    if (stat(sourceFile.c_str(), &sourceInfo) != 0)
+        throw std::runtime_error("Cannot compile image, " + sourceFile +
+                                 " does not exist");
+                                 
+    ImageHeader header = {};
+    std::copy(MAGIC, MAGIC + 4, header.magic);
+    header.version = VERSION;
+    header.nodeSize = sizeof(Node);
+    header.nodeCount = tree.size();
+    header.maxDepth = tree.getMaxDepth();
+    header.gridWidth = model.getGrid().getWidth();
+    header.gridHeight = model.getGrid().getHeight();
+    header.sourceSize = sourceInfo.st_size;
+    header.sourceMtime = getMtime(sourceInfo);
+    header.sourceHash = hashContents(Config::readFile(sourceFile));
+    
+    std::string strings;
+    auto addString = [&](const std::string & str) {
+        StringRef ref = {static_cast<uint32_t>(strings.size()),
+                         static_cast<uint32_t>(str.size())
+                        };
+        strings += str;
+        return ref;
+    };
+    
+    std::vector<CommandRecord> records;
+    for (command_handle command : tree.getLeaves(tree.getRoot()))
+        records.push_back({addString(CommandRegistry::getName(command)),
+                           addString(CommandRegistry::getCommand(command)),
+                           addString(CommandRegistry::getIconName(command))});
+    header.commandCount = records.size();
+    
+    header.nodesOffset = align(sizeof(ImageHeader));
+    header.commandsOffset = align(header.nodesOffset +
+                                  header.nodeCount * sizeof(Node));
+    header.stringsOffset = align(header.commandsOffset +
+                                 records.size() * sizeof(CommandRecord));
+    header.stringsSize = strings.size();
+    
+    // Write to a temporary file first so that a running instance never
+    // maps a half written image
+    const std::string tempFile = imageFile + ".tmp";
+    std::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    padTo(out, header.nodesOffset);
+    for (node_id id = 0; id < tree.size(); id++)
+        out.write(reinterpret_cast<const char*>(&tree.getNode(id)), sizeof(Node));
+    padTo(out, header.commandsOffset);
+    out.write(reinterpret_cast<const char*>(records.data()),
+              records.size() * sizeof(CommandRecord));
+    padTo(out, header.stringsOffset);
+    out.write(strings.data(), strings.size());
+    out.close();
+    
+    if (!out || std::rename(tempFile.c_str(), imageFile.c_str()) != 0)
+        throw std::runtime_error("Failed to write image " + imageFile);
+}
+
+std::shared_ptr<const Model::command_tree> TrieImage::load(
+    const std::string& imageFile, const std::string& sourceFile,
+    const GridGeometry& grid) {
+    int fd = open(imageFile.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+        
+    struct stat imageInfo;
+    if (fstat(fd, &imageInfo) != 0 ||
+            static_cast<size_t>(imageInfo.st_size) < sizeof(ImageHeader)) {
+        close(fd);
+        return nullptr;
+    }
+    
+    const size_t length = imageInfo.st_size;
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        return nullptr;
+        
+    std::shared_ptr<const void> mapping(address, [length](const void* ptr) {
+        munmap(const_cast<void*>(ptr), length);
+    });
+    
+    const char* base = static_cast<const char*>(address);
+    const ImageHeader& header = *reinterpret_cast<const ImageHeader*>(base);
+    if (!isValid(header, length) || isStale(header, sourceFile))
+        return nullptr;
+        
+    // Paths were laid out for a different grid
+    if (header.gridWidth != static_cast<uint32_t>(grid.getWidth()) ||
+            header.gridHeight != static_cast<uint32_t>(grid.getHeight()))
+        return nullptr;
+        
+    const Node* nodes = reinterpret_cast<const Node*>(base + header.nodesOffset);
+    for (uint32_t i = 0; i < header.nodeCount; i++)
+        if (!isValid(nodes, i, header))
+            return nullptr;
+            
+    const CommandRecord* records =
+        reinterpret_cast<const CommandRecord*>(base + header.commandsOffset);
+    const char* strings = base + header.stringsOffset;
+    auto getString = [&](const StringRef & ref, std::string & output) {
+        if (static_cast<uint64_t>(ref.offset) + ref.length > header.stringsSize)
+            return false;
+        output.assign(strings + ref.offset, ref.length);
+        return true;
+    };
+    
+    // Images loaded together share the registry's copy of each command
+    std::vector<command_handle> commands(header.commandCount);
+    std::string name, command, iconName;
+    for (uint32_t i = 0; i < header.commandCount; i++) {
+        if (!getString(records[i].name, name) ||
+                !getString(records[i].command, command) ||
+                !getString(records[i].icon, iconName))
+            return nullptr;
+        commands[i] = CommandRegistry::add(name, command, iconName);
+    }
+    
+    return std::make_shared<Model::command_tree>(nodes, header.nodeCount,
+            std::move(commands), header.maxDepth, mapping);
+}
+
+bool TrieImage::modifiedSince(const std::string& path,
+                              const std::string& imageFile) {
+    struct stat pathInfo, imageInfo;
+    if (stat(imageFile.c_str(), &imageInfo) != 0)
+        return true;
+    if (stat(path.c_str(), &pathInfo) != 0)
+        return false;
+    return getMtime(pathInfo) > getMtime(imageInfo);
+}
+
+void TrieImage::touch(const std::string& imageFile) {
+    utimensat(AT_FDCWD, imageFile.c_str(), nullptr, 0);
+}
@@ -53,4 +53,12 @@ void util::executeCommand(std::string command) {
     QProcess sh;
     sh.setWorkingDirectory("~/");
     sh.startDetached(QString::fromStdString(command));
-}
\ No newline at end of file
+}
+
+std::string util::trim(const std::string& text) {
+    const char* whitespace = " \t\r\n";
+    size_t first = text.find_first_not_of(whitespace);
+    if (first == std::string::npos)
+        return std::string();
+    return text.substr(first, text.find_last_not_of(whitespace) - first + 1);
+}
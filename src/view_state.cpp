@@ -0,0 +1,117 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#include <algorithm>
+
+#include "view_state.h"
+
+bool ViewState::Delta::empty() const {
+    return tinted.empty() && iconsChanged.empty() && segmentsAdded.empty() &&
+           segmentsRemoved.empty();
+}
+
+ViewState::ViewState(const GridGeometry& grid) :
+    grid(grid),
+    cells(grid.getCellCount(), Cell {Tint::NONE, std::vector<command_handle>()}),
+    segments() {
+}
+
+void ViewState::clear() {
+    // Keeps the storage of every cell, so states are rebuilt
+    // without allocating once they have grown
+    for (auto& cell : this->cells) {
+        cell.tint = Tint::NONE;
+        cell.commands.clear();
+    }
+    this->segments.clear();
+}
+
+void ViewState::showModel(const Model& model) {
+    this->clear();
+    util::Span<std::pair<int, int>> path = model.getPath();
+    int last = -1;
+    for (auto& position : path) {
+        int cell = this->grid.toCell(position);
+        this->cells[cell].tint = Tint::SELECTED;
+        if (last != -1)
+            this->addSegment(last, cell);
+        last = cell;
+    }
+    this->cells[last].tint = Tint::HIGHLIGHTED;
+    
+    for (Direction direction : model.getViableDirections()) {
+        int cell = this->grid.getNeighbour(last, direction);
+        util::Span<command_handle> commands = model.getCommandsInDirection(direction);
+        this->cells[cell].commands.assign(commands.begin(), commands.end());
+    }
+}
+
+void ViewState::showResults(const std::vector<command_handle>& results) {
+    this->clear();
+    if (results.empty())
+        return;
+        
+    const int root = this->grid.toCell(this->grid.getRoot());
+    this->cells[root].tint = Tint::HIGHLIGHTED;
+    size_t shown = 0;
+    auto show = [&](int cell) {
+        if (cell == -1 || shown == results.size())
+            return;
+        this->cells[cell].commands.assign(1, results[shown++]);
+    };
+    show(root);
+    for (Direction direction : DirectionSet(0xFF))
+        show(this->grid.getNeighbour(root, direction));
+}
+
+const ViewState::Cell& ViewState::getCell(int cell) const {
+    return this->cells[cell];
+}
+
+const std::vector<ViewState::segment>& ViewState::getSegments() const {
+    return this->segments;
+}
+
+void ViewState::diff(const ViewState& next, Delta& delta) const {
+    delta.tinted.clear();
+    delta.iconsChanged.clear();
+    delta.segmentsAdded.clear();
+    delta.segmentsRemoved.clear();
+    
+    for (int cell = 0; cell < static_cast<int>(this->cells.size()); cell++) {
+        const Cell& before = this->cells[cell];
+        const Cell& after = next.cells[cell];
+        if (before.tint != after.tint)
+            delta.tinted.push_back(cell);
+        if (before.commands != after.commands)
+            delta.iconsChanged.push_back(cell);
+    }
+    
+    std::set_difference(next.segments.begin(), next.segments.end(),
+                        this->segments.begin(), this->segments.end(),
+                        std::back_inserter(delta.segmentsAdded));
+    std::set_difference(this->segments.begin(), this->segments.end(),
+                        next.segments.begin(), next.segments.end(),
+                        std::back_inserter(delta.segmentsRemoved));
+}
+
+void ViewState::addSegment(int from, int to) {
+    segment added = std::make_pair(std::min(from, to), std::max(from, to));
+    auto found = std::lower_bound(this->segments.begin(), this->segments.end(),
+                                  added);
+    if (found == this->segments.end() || *found != added)
+        this->segments.insert(found, added);
+}
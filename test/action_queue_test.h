@@ -0,0 +1,101 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+#pragma once
+
+#include <cxxtest/TestSuite.h>
+#include <thread>
+#include <vector>
+#include "assert.h"
+#include "action.h"
+#include "action_queue.h"
+
+class ActionQueueTestSuite : public CxxTest::TestSuite {
+  public:
+  
+    ActionQueueTestSuite() {}
+    
+    void setUp() {
+    
+    }
+    
+    void test_queue() {
+        ActionQueue queue(3);
+        Action action;
+        assert(!queue.pop(action));
+        
+        // Capacity is rounded up to four, and a full queue drops actions
+        for (int i = 0; i < 4; i++) {
+            assert(!queue.isFull());
+            assert(queue.push(Action::move(static_cast<Direction>(i))));
+        }
+        assert(queue.isFull());
+        assert(!queue.push(Action(Action::Type::SHOW)));
+        
+        for (int i = 0; i < 4; i++) {
+            assert(queue.pop(action));
+            assert(action == Action::move(static_cast<Direction>(i)));
+            assert(!queue.isFull());
+        }
+        assert(!queue.pop(action));
+        
+        // Cells are reused on the next lap
+        assert(queue.push(Action(Action::Type::EXIT)));
+        assert(queue.pop(action));
+        assert(action.type == Action::Type::EXIT);
+        
+        ActionQueue::Statistics statistics = queue.getStatistics();
+        assert(statistics.pushed == 5);
+        assert(statistics.dropped == 1);
+        assert(statistics.popped == 5);
+        assert(statistics.maxLatencyMs >= statistics.meanLatencyMs);
+    }
+    
+    void test_producers() {
+        const int producerCount = 4;
+        const uint32_t perProducer = 20000;
+        ActionQueue queue(64);
+        
+        // Each producer numbers its actions, which have to arrive in order
+        std::vector<std::thread> producers;
+        for (int producer = 0; producer < producerCount; producer++) {
+            producers.push_back(std::thread([&queue, producer, perProducer]() {
+                for (uint32_t i = 0; i < perProducer; i++) {
+                    Action action = Action::move(static_cast<Direction>(producer));
+                    std::memcpy(action.text, &i, 3);
+                    while (!queue.push(action))
+                        std::this_thread::yield();
+                }
+            }));
+        }
+        
+        std::vector<uint32_t> next(producerCount, 0);
+        uint32_t received = 0;
+        Action action;
+        while (received < producerCount * perProducer) {
+            if (!queue.pop(action))
+                continue;
+            uint32_t number = 0;
+            std::memcpy(&number, action.text, 3);
+            assert(number == next[static_cast<int>(action.direction)]++);
+            received++;
+        }
+        for (auto& producer : producers)
+            producer.join();
+        assert(!queue.pop(action));
+        assert(queue.getStatistics().popped == producerCount * perProducer);
+    }
+};
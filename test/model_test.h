@@ -18,10 +18,33 @@
 #pragma once
 
 #include <cxxtest/TestSuite.h>
+#include <new>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
 #include "assert.h"
 #include "util.h"
 #include "node.h"
 #include "model.h"
+#include "path_assigner.h"
+#include "context_set.h"
+#include "view_state.h"
+
+// Counts every heap allocation made by this test runner, so that
+// navigation can be checked to be allocation free
+static size_t allocationCount = 0;
+
+void* operator new(std::size_t size) {
+    allocationCount++;
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
 
 class ModelTestSuite : public CxxTest::TestSuite {
   public:
@@ -37,20 +60,335 @@ class ModelTestSuite : public CxxTest::TestSuite {
         auto first_path = util::vec2i({ {1, 1}, {1, 2}, {2, 2} });
         auto second_path = util::vec2i({ {1, 1}, {1, 0}, {0, 0} });
         paths.push_back(
-            std::make_pair(util::Command {"Example"},
+            std::make_pair(CommandRegistry::add("Example", "", ""),
                            std::make_shared<util::vec2i>(first_path)));
         paths.push_back(
-            std::make_pair(util::Command {"Example2"},
+            std::make_pair(CommandRegistry::add("Example2", "", ""),
                            std::make_shared<util::vec2i>(second_path)));
         Model model(paths);
-        std::shared_ptr<Model> child = model.select("u_");
-        assert((model.getCurrentPosition() - child->getCurrentPosition() ==
+        Model child = model;
+        assert(child.advance(Direction::UP));
+        assert((model.getCurrentPosition() - child.getCurrentPosition() ==
                 std::make_pair(0, 1)));
-        DEBUG(child->select("l_")->getCommand()->name);
-        assert(child->select("l_")->getCommand()->name == "Example2");
-        assert((*(model.getCommandsInDirection("d_")))[0].name == "Example");
-        assert((*(model.getCommandsInDirection("u_")))[0].name == "Example2");
-        util::vec2i path = *(child->select("l_")->getPath());
+        assert(!child.advance(Direction::DOWN));
+        assert(child.advance(Direction::LEFT));
+        DEBUG(CommandRegistry::getName(child.getCommand()));
+        assert(CommandRegistry::getName(child.getCommand()) == "Example2");
+        assert(CommandRegistry::getName(
+                   model.getCommandsInDirection(Direction::DOWN)[0]) == "Example");
+        assert(CommandRegistry::getName(
+                   model.getCommandsInDirection(Direction::UP)[0]) == "Example2");
+        util::vec2i path(child.getPath().begin(), child.getPath().end());
         DEBUGARR(path);
+        assert((path == util::vec2i({ {1, 1}, {1, 0}, {0, 0} })));
+        assert(child.back());
+        assert((util::vec2i(child.getPath().begin(), child.getPath().end()) ==
+                util::vec2i({ {1, 1}, {1, 0} })));
+        child.reset();
+        assert(!child.back());
+        assert(child.getCurrentPosition() == model.getRootPosition());
+    }
+    
+    void test_navigation_does_not_allocate() {
+        std::vector<Model::command_position> paths;
+        auto first_path = util::vec2i({ {1, 1}, {1, 2}, {2, 2}, {2, 1}, {1, 1} });
+        auto second_path = util::vec2i({ {1, 1}, {1, 0}, {0, 0} });
+        paths.push_back(
+            std::make_pair(CommandRegistry::add("Example", "", ""),
+                           std::make_shared<util::vec2i>(first_path)));
+        paths.push_back(
+            std::make_pair(CommandRegistry::add("Example2", "", ""),
+                           std::make_shared<util::vec2i>(second_path)));
+        Model model(paths);
+        
+        size_t before = allocationCount;
+        for (int i = 0; i < 100; i++) {
+            for (Direction direction : model.getViableDirections())
+                assert(model.getCommandsInDirection(direction).size() == 1);
+            model.advance(Direction::DOWN);
+            model.advance(Direction::RIGHT);
+            model.advance(Direction::UP);
+            model.advance(Direction::LEFT);
+            assert(CommandRegistry::getName(model.getCommand()) == "Example");
+            assert(model.getPath().size() == 5);
+            model.back();
+            model.back();
+            model.reset();
+            model.advance(Direction::UP);
+            model.advance(Direction::LEFT);
+            assert(CommandRegistry::getName(model.getCommand()) == "Example2");
+            model.reset();
+        }
+        assert(allocationCount == before);
+    }
+    
+    void test_grid() {
+        GridGeometry small;
+        GridGeometry large = GridGeometry::create(5, 5);
+        GridGeometry odd = GridGeometry::create(4, 3);
+        assert(small.getCellCount() == 9);
+        assert(large.getRoot() == std::make_pair(2, 2));
+        assert(odd.getRoot() == std::make_pair(2, 1));
+        
+        // Compile time and runtime tables both match the grid bounds
+        for (GridGeometry grid : { large, GridGeometry::create(5, 4) }) {
+            for (int cell = 0; cell < grid.getCellCount(); cell++) {
+                std::pair<int, int> position = grid.toPosition(cell);
+                for (Direction direction : DirectionSet(0xFF)) {
+                    std::pair<int, int> next = position + getDelta(direction);
+                    int expected = grid.contains(next) ? grid.toCell(next) : -1;
+                    assert(grid.getNeighbour(cell, direction) == expected);
+                }
+            }
+        }
+        
+        std::vector<Model::command_position> paths;
+        auto long_path = util::vec2i({ {2, 2}, {3, 3}, {4, 4} });
+        paths.push_back(
+            std::make_pair(CommandRegistry::add("Corner", "", ""),
+                           std::make_shared<util::vec2i>(long_path)));
+        Model model(paths, large);
+        assert(model.getCurrentPosition() == std::make_pair(2, 2));
+        assert(model.advance(Direction::DOWN_RIGHT));
+        assert(model.advance(Direction::DOWN_RIGHT));
+        assert(CommandRegistry::getName(model.getCommand()) == "Corner");
+        
+        // The same moves do not fit on the default grid
+        paths[0].second = std::make_shared<util::vec2i>(
+                              util::vec2i({ {1, 1}, {2, 2}, {3, 3} }));
+        bool threw = false;
+        try {
+            Model outside(paths);
+        } catch (std::runtime_error& e) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    
+    void test_assign_paths() {
+        const size_t count = 10000;
+        std::vector<Model::command_position> paths;
+        auto fixed = std::make_shared<util::vec2i>(
+                         util::vec2i({ {1, 1}, {2, 1} }));
+        paths.push_back(std::make_pair(CommandRegistry::add("Fixed", "fixed", ""),
+                                       fixed));
+        for (size_t i = 0; i < count; i++) {
+            std::string name = "app" + std::to_string(i);
+            paths.push_back(std::make_pair(CommandRegistry::add(name, name, ""),
+                                           std::make_shared<util::vec2i>()));
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        size_t assigned = PathAssigner::assign(paths, GridGeometry(),
+        [](command_handle command) {
+            return CommandRegistry::getCommand(command) == "app9999" ? 100.0 : 0.0;
+        });
+        double elapsed = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - start).count();
+        assert(assigned == count);
+        std::cout << std::endl << "Assigned paths to " << count
+                  << " applications in " << elapsed << " ms";
+        
+        // Hand-assigned paths are left alone
+        assert(paths[0].second == fixed);
+        assert(fixed->size() == 2);
+        
+        // The most launched application is closer than any other
+        for (size_t i = 1; i < count; i++)
+            assert(paths.back().second->size() < paths[i].second->size());
+            
+        // Every command ends up on its own leaf
+        Model model(paths);
+        for (auto& path : paths) {
+            model.reset();
+            const util::vec2i& positions = *(path.second);
+            for (size_t i = 1; i < positions.size(); i++)
+                assert(model.advance(
+                           getDeltaDirection(positions[i] - positions[i - 1])));
+            assert(model.getCommand() != NO_COMMAND);
+            assert(model.getCommand() == path.first);
+        }
+    }
+    
+    void test_compressed() {
+        std::vector<Model::command_position> paths;
+        auto addPath = [&](const std::string & name, util::vec2i path) {
+            paths.push_back(std::make_pair(CommandRegistry::add(name, name, ""),
+                                           std::make_shared<util::vec2i>(path)));
+        };
+        addPath("UpLeft", { {1, 1}, {1, 0}, {0, 0} });
+        addPath("UpRight", { {1, 1}, {1, 0}, {2, 0} });
+        addPath("Chain", { {1, 1}, {2, 2}, {2, 1}, {2, 0} });
+        Model model(paths);
+        model.setCompressed(true);
+        
+        // A single move runs down the whole chain, but every cell is drawn
+        assert(model.advance(Direction::DOWN_RIGHT));
+        assert(CommandRegistry::getName(model.getCommand()) == "Chain");
+        assert(model.getPath().size() == 4);
+        assert(model.getCurrentPosition() == std::make_pair(2, 0));
+        assert(model.back());
+        assert(model.getCurrentNode() == model.getTree().getRoot());
+        assert(model.getPath().size() == 1);
+        
+        // Branch points still wait for a choice
+        assert(model.advance(Direction::UP));
+        assert(model.getCommand() == NO_COMMAND);
+        assert(model.getPath().size() == 2);
+        
+        model.reset();
+        model.setCompressed(false);
+        assert(model.advance(Direction::DOWN_RIGHT));
+        assert(model.getPath().size() == 2);
+    }
+    
+    void test_contexts() {
+        auto makeTree = [](const std::string & name) {
+            std::vector<Model::command_position> paths;
+            paths.push_back(std::make_pair(CommandRegistry::add(name, name, ""),
+                                           std::make_shared<util::vec2i>(
+                                                   util::vec2i({ {1, 1}, {1, 0} }))));
+            return Model(paths).getSharedTree();
+        };
+        ContextSet contexts(makeTree("Default"));
+        contexts.add("URxvt", makeTree("Terminal"));
+        assert(contexts.size() == 1);
+        assert(contexts.get("URxvt") != contexts.getDefault());
+        assert(contexts.get("Firefox") == contexts.getDefault());
+        assert(contexts.get("") == contexts.getDefault());
+        
+        // Switching layouts shares the tree rather than copying it
+        Model model(contexts.getDefault());
+        model.setTree(contexts.get("URxvt"));
+        assert(model.getSharedTree() == contexts.get("URxvt"));
+        assert(model.advance(Direction::UP));
+        assert(CommandRegistry::getName(model.getCommand()) == "Terminal");
+        model.setTree(contexts.get("Firefox"));
+        assert(model.getPath().size() == 1);
+        assert(model.advance(Direction::UP));
+        assert(CommandRegistry::getName(model.getCommand()) == "Default");
+    }
+    
+    void test_registry() {
+        command_handle files = CommandRegistry::add("Files", "nautilus",
+                               "system-file-manager");
+        command_handle browser = CommandRegistry::add("Browser", "nautilus",
+                                 "system-file-manager");
+        assert(files != browser);
+        
+        // The same command registered twice, e.g. by two layouts,
+        // is stored once
+        size_t size = CommandRegistry::size();
+        assert(CommandRegistry::add("Files", "nautilus",
+                                    "system-file-manager") == files);
+        assert(CommandRegistry::size() == size);
+        
+        // Strings are interned
+        assert(&CommandRegistry::getCommand(files) ==
+               &CommandRegistry::getCommand(browser));
+        assert(&CommandRegistry::getIconName(files) ==
+               &CommandRegistry::getIconName(browser));
+        assert(CommandRegistry::getName(browser) == "Browser");
+        
+        bool thrown = false;
+        try {
+            CommandRegistry::getName(NO_COMMAND);
+        } catch (std::runtime_error& e) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    
+    void test_empty_root() {
+        // Nothing configured, or everything removed, leaves a root
+        // that is a leaf without a command
+        std::vector<Model::command_position> paths;
+        paths.push_back(std::make_pair(CommandRegistry::add("Pathless",
+                                       "pathless", ""), std::make_shared<util::vec2i>()));
+        Model empty(paths);
+        assert(empty.getCommand() == NO_COMMAND);
+        
+        paths.clear();
+        paths.push_back(std::make_pair(CommandRegistry::add("Gone", "gone", ""),
+                                       std::make_shared<util::vec2i>(
+                                           util::vec2i({ {1, 1}, {1, 0} }))));
+        Model model(paths);
+        model.remove("gone");
+        assert(model.getCommand() == NO_COMMAND);
+        assert(!model.back());
+        assert(model.getCommand() == NO_COMMAND);
+    }
+    
+    void test_view_state() {
+        std::vector<Model::command_position> paths;
+        command_handle down = CommandRegistry::add("Down", "down", "");
+        command_handle up = CommandRegistry::add("Up", "up", "");
+        paths.push_back(std::make_pair(down, std::make_shared<util::vec2i>(
+                                           util::vec2i({ {1, 1}, {1, 2}, {2, 2} }))));
+        paths.push_back(std::make_pair(up, std::make_shared<util::vec2i>(
+                                           util::vec2i({ {1, 1}, {1, 0}, {0, 0} }))));
+        Model model(paths);
+        
+        // Showing the root on a blank overlay touches the root
+        // and the two cells with icons
+        ViewState shown;
+        ViewState next;
+        ViewState::Delta delta;
+        next.showModel(model);
+        shown.diff(next, delta);
+        assert((delta.tinted == std::vector<int>({4})));
+        assert((delta.iconsChanged == std::vector<int>({1, 7})));
+        assert(delta.segmentsAdded.empty() && delta.segmentsRemoved.empty());
+        assert(next.getCell(1).commands[0] == up);
+        std::swap(shown, next);
+        
+        // Moving touches both ends of the move and the icons
+        // that came and went, nothing else
+        assert(model.advance(Direction::UP));
+        next.showModel(model);
+        shown.diff(next, delta);
+        assert((delta.tinted == std::vector<int>({1, 4})));
+        assert((delta.iconsChanged == std::vector<int>({0, 1, 7})));
+        assert((delta.segmentsAdded == std::vector<ViewState::segment>({ {1, 4} })));
+        assert(delta.segmentsRemoved.empty());
+        assert(next.getCell(4).tint == ViewState::Tint::SELECTED);
+        assert(next.getCell(1).tint == ViewState::Tint::HIGHLIGHTED);
+        std::swap(shown, next);
+        
+        assert(model.back());
+        next.showModel(model);
+        shown.diff(next, delta);
+        assert((delta.segmentsRemoved == std::vector<ViewState::segment>({ {1, 4} })));
+        assert(delta.segmentsAdded.empty());
+        std::swap(shown, next);
+        
+        // Nothing changes when the same state is shown again
+        next.showModel(model);
+        shown.diff(next, delta);
+        assert(delta.empty());
+        
+        // The same results, even copied elsewhere, change nothing either
+        std::vector<command_handle> results({up, down});
+        shown.showResults(results);
+        next.showResults(std::vector<command_handle>(results));
+        shown.diff(next, delta);
+        assert(delta.empty());
+        assert(next.getCell(4).commands[0] == up);
+        assert(next.getCell(4).tint == ViewState::Tint::HIGHLIGHTED);
+        
+        next.clear();
+        shown.diff(next, delta);
+        assert((delta.tinted == std::vector<int>({4})));
+        assert(delta.iconsChanged.size() == 2);
+        // A state keeps its own copy of the icons, so it is still told
+        // apart from the tree it was built from after that tree changes
+        shown.showModel(model);
+        command_handle other = CommandRegistry::add("Other", "other", "");
+        model.insert(other, util::vec2i({ {1, 1}, {1, 0}, {2, 0} }));
+        next.showModel(model);
+        shown.diff(next, delta);
+        assert((delta.iconsChanged == std::vector<int>({1})));
+        assert(next.getCell(1).commands.size() == 2);
+        assert(shown.getCell(1).commands.size() == 1);
     }
 };
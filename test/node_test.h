@@ -18,9 +18,11 @@
 #pragma once
 
 #include <cxxtest/TestSuite.h>
+#include <type_traits>
 #include "assert.h"
 #include "util.h"
 #include "node.h"
+#include "action.h"
 
 class NodeTestSuite : public CxxTest::TestSuite {
   public:
@@ -31,34 +33,146 @@ class NodeTestSuite : public CxxTest::TestSuite {
     
     }
     
-    void test_unpack() {
-        Node<util::Command> node;
-        Node<util::Command> node2;
-        Node<util::Command> node3;
-        util::Command testing;
-        testing.name = "Testing";
-        node.setElement("r_", node2);
-        node.getElement("r_")->setData(testing);
-        node.getElement("r_")->setElement("ur", node3);
-        node.getElement("r_")->getElement("ur")->setData(testing);
-        auto unpackedChildren = * (node.unpack());
-        for (auto element : unpackedChildren) {
-            if (element.second != nullptr)
-                assert(element.first == "r_");
+    void test_tree() {
+        Tree<std::string> tree;
+        std::string testing = "Testing";
+        node_id root = tree.getRoot();
+        node_id right = tree.addChild(root, Direction::RIGHT);
+        node_id upRight = tree.addChild(right, Direction::UP_RIGHT);
+        tree.setData(upRight, testing);
+        
+        // Adding an existing child returns the same node
+        assert(tree.addChild(root, Direction::RIGHT) == right);
+        assert(tree.size() == 3);
+        
+        assert(tree.hasChild(root, Direction::RIGHT));
+        assert(!tree.hasChild(root, Direction::LEFT));
+        assert(!tree.hasChild(root, Direction::INVALID));
+        assert(tree.getChild(root, Direction::LEFT) == NO_NODE);
+        assert(tree.getParent(upRight) == right);
+        assert(tree.getParent(root) == NO_NODE);
+        
+        assert(!tree.isLeaf(root));
+        assert(!tree.isLeaf(right));
+        assert(tree.isLeaf(upRight));
+        
+        assert(tree.getData(right) == nullptr);
+        assert(*tree.getData(upRight) == "Testing");
+        
+        tree.computeLeafRanges();
+        auto leaves = tree.getLeaves(root);
+        assert(leaves.size() == 1);
+        assert(leaves[0] == "Testing");
+        assert(*tree.getData(upRight) == "Testing");
+    }
+    
+    void test_leaf_ranges() {
+        Tree<std::string> tree;
+        node_id root = tree.getRoot();
+        node_id up = tree.addChild(root, Direction::UP);
+        node_id down = tree.addChild(root, Direction::DOWN);
+        node_id upLeft = tree.addChild(up, Direction::LEFT);
+        node_id upRight = tree.addChild(up, Direction::RIGHT);
+        tree.setData(down, std::string("Down"));
+        tree.setData(upLeft, std::string("UpLeft"));
+        tree.setData(upRight, std::string("UpRight"));
+        tree.computeLeafRanges();
+        
+        // Leaves are stored in DFS order, so every subtree is contiguous
+        assert(tree.getLeaves(root).size() == 3);
+        auto upLeaves = tree.getLeaves(up);
+        assert(upLeaves.size() == 2);
+        assert(upLeaves[0] == "UpRight");
+        assert(upLeaves[1] == "UpLeft");
+        assert(tree.getLeaves(down).size() == 1);
+        assert(tree.getLeaves(down)[0] == "Down");
+        assert(*tree.getData(upLeft) == "UpLeft");
+    }
+    
+    void test_directions() {
+        for (int i = 0; i < NUM_DIRECTIONS; i++) {
+            Direction direction = static_cast<Direction>(i);
+            assert(getDeltaDirection(getDelta(direction)) == direction);
+            assert(directionFromString(directionToString(direction)) == direction);
         }
-        std::shared_ptr<Node<util::Command>::collapsed_children> collapsed =
-            node.getCollapsedPossibilities();
-        assert(!node.isLeaf());
-        assert(node2.isLeaf());
-        for (auto element : (*collapsed)) {
-            std::cout << "(" << element.first << ", " << element.second.size() << ")" <<
-                      std::endl;
-            if (element.second.size() > 0) {
-                assert(element.second.size() == 1);
-                for (auto e : element.second) {
-                    std::cout << "\t" << *e << std::endl;
-                }
-            }
+        assert(directionFromString("BACK") == Direction::INVALID);
+        assert(getDeltaDirection(std::make_pair(2, 0)) == Direction::INVALID);
+    }
+    
+    void test_actions() {
+        static_assert(std::is_trivially_copyable<Action>::value,
+                      "Actions are passed around by value");
+        static_assert(getDeltaDirection(getDelta(Direction::UP_LEFT)) ==
+                      Direction::UP_LEFT, "Delta tables are constexpr");
+                      
+        for (int i = 0; i < NUM_DIRECTIONS; i++) {
+            Action move = Action::move(static_cast<Direction>(i));
+            assert(Action::fromString(move.toString()) == move);
+        }
+        for (auto name : {"BACK", "EXIT", "SHOW", "SEARCH", "SEARCH_RUN"})
+            assert(Action::fromString(name).toString() == name);
+        assert(Action::fromString("MOVE").type == Action::Type::NONE);
+        assert(Action::fromString("jump").type == Action::Type::NONE);
+        
+        // Typing carries a single UTF-8 character
+        const std::string text = "\xc3\xa9t\xc3\xa9";
+        Action typed = Action::character(text.data(), text.size());
+        assert(typed.type == Action::Type::SEARCH_TYPE);
+        assert(typed.getTextLength() == 2);
+        assert(typed.toString() == "SEARCH_TYPE:\xc3\xa9");
+        assert(Action::fromString(typed.toString()) == typed);
+        assert(typed != Action::character("t", 1));
+    }
+    
+    void test_insert_remove() {
+        Tree<std::string> tree;
+        node_id root = tree.getRoot();
+        tree.insert({Direction::UP, Direction::LEFT}, std::string("UpLeft"));
+        tree.insert({Direction::DOWN}, std::string("Down"));
+        auto affected = tree.insert({Direction::UP, Direction::RIGHT},
+                                    std::string("UpRight"));
+        node_id up = tree.getChild(root, Direction::UP);
+        node_id upRight = tree.getChild(up, Direction::RIGHT);
+        assert(affected == std::vector<node_id>({root, up, upRight}));
+        assertRangesConsistent(tree);
+        assert(tree.getLeaves(up)[0] == "UpRight");
+        
+        // Replacing a value leaves the ranges alone
+        tree.insert({Direction::DOWN}, std::string("Down2"));
+        assert(tree.getLeaves(root).size() == 3);
+        assertRangesConsistent(tree);
+        
+        // Removing the last leaf under a branch prunes the branch
+        node_id upLeft = tree.getChild(up, Direction::LEFT);
+        affected = tree.remove(upLeft);
+        assert(affected == std::vector<node_id>({upLeft, up, root}));
+        assertRangesConsistent(tree);
+        affected = tree.remove(upRight);
+        assert(affected == std::vector<node_id>({upRight, up, root}));
+        assert(!tree.contains(up));
+        assert(!tree.hasChild(root, Direction::UP));
+        assert(tree.getLeaves(root).size() == 1);
+        assertRangesConsistent(tree);
+        assert(tree.remove(up).empty());
+        
+        // Pruned nodes are reused
+        size_t size = tree.size();
+        tree.insert({Direction::LEFT, Direction::LEFT}, std::string("Left"));
+        assert(tree.size() == size);
+        assertRangesConsistent(tree);
+    }
+    
+    // Checks incrementally maintained ranges against a full recomputation
+    void assertRangesConsistent(const Tree<std::string>& tree) {
+        Tree<std::string> expected(tree);
+        expected.computeLeafRanges();
+        for (node_id id = 0; id < tree.size(); id++) {
+            if (!tree.contains(id))
+                continue;
+            assert(tree.getNode(id).leafBegin == expected.getNode(id).leafBegin);
+            assert(tree.getNode(id).leafEnd == expected.getNode(id).leafEnd);
+            if (tree.getData(id) != nullptr)
+                assert(*tree.getData(id) == *expected.getData(id));
         }
     }
 };
\ No newline at end of file
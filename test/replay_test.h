@@ -0,0 +1,273 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include "assert.h"
+#include "action.h"
+#include "action_recorder.h"
+#include "replay_input.h"
+#include "launch_gate.h"
+#include "model.h"
+
+class ReplayTestSuite : public CxxTest::TestSuite {
+  public:
+  
+    ReplayTestSuite() {}
+    
+    void setUp() {
+    
+    }
+    
+    void test_round_trip() {
+        const char* file = "replay_test.rec";
+        std::vector<Action> actions({
+            Action(Action::Type::SHOW),
+            Action::move(Direction::UP_LEFT),
+            Action::character("\xc3\xa9", 2),
+            Action(Action::Type::SEARCH_RUN)
+        });
+        {
+            ActionRecorder recorder(file);
+            for (auto& action : actions)
+                recorder.record(action);
+        }
+        
+        std::vector<ActionRecorder::Entry> entries = ActionRecorder::load(file);
+        assert(entries.size() == actions.size());
+        for (size_t i = 0; i < entries.size(); i++) {
+            assert(entries[i].action == actions[i]);
+            assert(i == 0 || entries[i].time >= entries[i - 1].time);
+        }
+        
+        // Anything else is refused rather than misread
+        FILE* garbage = std::fopen(file, "w");
+        std::fputs("not a recording", garbage);
+        std::fclose(garbage);
+        bool thrown = false;
+        try {
+            ActionRecorder::load(file);
+        } catch (std::runtime_error& e) {
+            thrown = true;
+        }
+        assert(thrown);
+        std::remove(file);
+    }
+    
+    void test_generate() {
+        std::vector<Model::command_position> paths;
+        paths.push_back(std::make_pair(CommandRegistry::add("Deep", "deep", ""),
+                                       std::make_shared<util::vec2i>(
+                                           util::vec2i({ {1, 1}, {1, 0}, {0, 0}, {0, 1} }))));
+        paths.push_back(std::make_pair(CommandRegistry::add("Shallow", "shallow",
+                                       ""), std::make_shared<util::vec2i>(
+                                           util::vec2i({ {1, 1}, {2, 1} }))));
+        Model model(paths);
+        
+        // Paced at the given rate, and replaying it never launches anything
+        std::vector<ActionRecorder::Entry> entries =
+            ReplayInput::generate(model, 1000, 500.0, 7);
+        assert(entries.size() == 1000);
+        assert(entries[0].action.type == Action::Type::SHOW);
+        assert(entries[1].time - entries[0].time == 2000);
+        for (auto& entry : entries) {
+            switch (entry.action.type) {
+                case Action::Type::MOVE:
+                    assert(model.advance(entry.action.direction));
+                    break;
+                case Action::Type::BACK:
+                    assert(model.back());
+                    break;
+                default:
+                    model.reset();
+                    break;
+            }
+            assert(model.getCommand() == NO_COMMAND);
+        }
+    }
+    
+    void test_lifecycle() {
+        std::vector<ActionRecorder::Entry> entries;
+        for (uint64_t i = 0; i < 100; i++)
+            entries.push_back(ActionRecorder::Entry {i, Action::move(Direction::UP)});
+        std::atomic<int> finished(0);
+        ReplayInput replay([](const Action & action) {}, entries, 0.0, [&]() {
+            finished++;
+        });
+        assert(replay.getState() == InputDevice::State::STOPPED);
+        
+        // Flapping only ever pauses and resumes the one worker
+        for (int i = 0; i < 50; i++) {
+            replay.start();
+            replay.pause();
+        }
+        replay.start();
+        for (int i = 0; i < 1000 &&
+                replay.getState() != InputDevice::State::FINISHED; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        assert(replay.getState() == InputDevice::State::FINISHED);
+        assert(finished == 1);
+        
+        Action action;
+        size_t taken = 0;
+        while (replay.takeAction(action)) {
+            assert(action == entries[taken].action);
+            taken++;
+        }
+        assert(taken == entries.size());
+        assert(replay.getStatistics().emitted == entries.size());
+        
+        // Nothing to resume once finished
+        replay.start();
+        assert(replay.getState() == InputDevice::State::FINISHED);
+        replay.stop();
+    }
+    
+    void test_restart() {
+        // Fails to start the first time, like a camera that is busy
+        class FlakyInput : public InputDevice {
+          public:
+            FlakyInput() : InputDevice([](const Action & action) {}), starts(0) {}
+            ~FlakyInput() {
+                this->stop();
+            }
+            std::string getName() const {
+                return "flaky";
+            }
+            void onKeyEvent(QKeyEvent* event) {}
+            void onFocusChange(const bool& hasFocus) {}
+            
+            std::atomic<int> starts;
+          protected:
+            bool hasWorker() const {
+                return true;
+            }
+            void onWorkerStart() {
+                if (this->starts++ == 0)
+                    throw std::runtime_error("Busy");
+            }
+            bool work() {
+                this->waitUntil(std::chrono::steady_clock::now() +
+                                std::chrono::milliseconds(1));
+                return true;
+            }
+        };
+        
+        FlakyInput flaky;
+        auto waitFor = [&](InputDevice::State state) {
+            for (int i = 0; i < 1000 && flaky.getState() != state; i++)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return flaky.getState() == state;
+        };
+        flaky.start();
+        assert(waitFor(InputDevice::State::FAILED));
+        
+        // Regaining focus tries again
+        flaky.start();
+        assert(flaky.getState() == InputDevice::State::RUNNING);
+        for (int i = 0; i < 1000 && flaky.starts < 2; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        assert(flaky.starts == 2);
+        flaky.pause();
+        assert(flaky.getState() == InputDevice::State::PAUSED);
+        flaky.stop();
+        assert(flaky.getState() == InputDevice::State::STOPPED);
+    }
+    
+    void test_backpressure() {
+        // Far more than the queue holds, replayed as fast as possible
+        std::vector<ActionRecorder::Entry> entries;
+        for (uint64_t i = 0; i < 5000; i++)
+            entries.push_back(ActionRecorder::Entry {i, Action::move(
+                                  static_cast<Direction>(i % NUM_DIRECTIONS))});
+        std::atomic<size_t> handled(0);
+        ReplayInput replay([](const Action & action) {}, entries, 0.0);
+        replay.setOutputHandler([&](const Action & action) {
+            handled++;
+        });
+        replay.start();
+        
+        // Taken while the worker waits for room, as the controller would
+        Action action;
+        size_t taken = 0;
+        for (int i = 0; i < 10000 && taken < entries.size(); i++) {
+            while (replay.takeAction(action)) {
+                assert(action == entries[taken].action);
+                taken++;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        assert(taken == entries.size());
+        assert(handled == entries.size());
+        assert(replay.getStatistics().dropped == 0);
+        replay.stop();
+    }
+    
+    void test_launch_debounce() {
+        std::vector<Model::command_position> paths;
+        command_handle shallow = CommandRegistry::add("Repeated", "repeated", "");
+        paths.push_back(std::make_pair(shallow, std::make_shared<util::vec2i>(
+                                           util::vec2i({ {1, 1}, {2, 1} }))));
+        Model model(paths);
+        
+        // A key repeat reaching the same leaf right after the first launch,
+        // then the same launch again once the window has passed
+        std::vector<ActionRecorder::Entry> entries;
+        for (uint64_t time : {0, 150000, 2000000}) {
+            entries.push_back(ActionRecorder::Entry {time, Action(Action::Type::SHOW)});
+            entries.push_back(ActionRecorder::Entry {time + 50000,
+                              Action::move(Direction::RIGHT)});
+        }
+        ReplayInput replay([](const Action & action) {}, entries, 0.0);
+        replay.start();
+        for (int i = 0; i < 1000 &&
+                replay.getState() != InputDevice::State::FINISHED; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            
+        LaunchGate gate(std::chrono::milliseconds(1000));
+        LaunchGate::clock::time_point origin;
+        Action action;
+        size_t taken = 0;
+        size_t launched = 0;
+        while (replay.takeAction(action)) {
+            const LaunchGate::clock::time_point now = origin +
+                    std::chrono::microseconds(entries[taken++].time);
+            if (action.type == Action::Type::MOVE)
+                model.advance(action.direction);
+            command_handle command = model.getCommand();
+            if (command != NO_COMMAND) {
+                assert(command == shallow);
+                if (gate.admit(command, now))
+                    launched++;
+                model.reset();
+            }
+        }
+        assert(taken == entries.size());
+        assert(launched == 2);
+        assert(gate.getStatistics().admitted == 2);
+        assert(gate.getStatistics().suppressed == 1);
+        
+        // Without a window nothing is held back
+        LaunchGate open(std::chrono::milliseconds(0));
+        assert(open.admit(shallow, origin));
+        assert(open.admit(shallow, origin));
+    }
+};
@@ -0,0 +1,174 @@
+// Copyright (C) 2016 by Srinivas Kaza <srinivas@kaza.io>
+
+// This file is part of NodeUI
+
+// NodeUI free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+
+// NodeUI is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+
+// You should have received a copy of the GNU General Public License along
+// with NodeUI.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cxxtest/TestSuite.h>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include "assert.h"
+#include "util.h"
+#include "model.h"
+#include "path_assigner.h"
+#include "search_index.h"
+
+class SearchTestSuite : public CxxTest::TestSuite {
+  public:
+  
+    SearchTestSuite() {}
+    
+    void setUp() {
+    
+    }
+    
+    void test_search() {
+        auto index = makeIndex({
+            {"Firefox", "firefox %u"},
+            {"LibreOffice Writer", "libreoffice --writer"},
+            {"LibreOffice Calc", "libreoffice --calc"},
+            {"Terminal", "gnome-terminal"},
+            {"Files", "nautilus"}
+        });
+        SearchIndex::Session session(index);
+        
+        // Short queries match the start of words
+        session.setQuery("f");
+        assert(session.getResults().size() == 2);
+        assert(CommandRegistry::getName(session.getResults()[0]) == "Files");
+        session.setQuery("c");
+        assert(CommandRegistry::getName(session.getResults()[0]) ==
+               "LibreOffice Calc");
+        
+        // Longer ones match anywhere, the name before the command line
+        session.setQuery("ter");
+        assert(CommandRegistry::getName(session.getResults()[0]) == "Terminal");
+        session.setQuery("Writer");
+        assert(session.getResults().size() == 1);
+        assert(CommandRegistry::getName(session.getResults()[0]) ==
+               "LibreOffice Writer");
+        session.setQuery("gnome");
+        assert(CommandRegistry::getName(session.getResults()[0]) == "Terminal");
+        
+        // A typo still finds the application
+        session.setQuery("libreofice");
+        assert(session.getResults().size() == 2);
+        session.setQuery("nautilsu");
+        assert(CommandRegistry::getName(session.getResults()[0]) == "Files");
+        
+        session.setQuery("");
+        assert(session.getResults().empty());
+    }
+    
+    void test_incremental() {
+        auto index = makeIndex(generateCommands(1000));
+        SearchIndex::Session typed(index);
+        const std::string query = "kora lumi";
+        for (size_t length = 1; length <= query.size(); length++) {
+            typed.setQuery(query.substr(0, length));
+            assertSameResults(typed, index);
+        }
+        
+        // Deleting and retyping lands on the same results as a fresh search
+        for (size_t length = query.size(); length > 0; length--) {
+            typed.setQuery(query.substr(0, length));
+            assertSameResults(typed, index);
+        }
+        typed.setQuery("lumikora");
+        assertSameResults(typed, index);
+    }
+    
+    void test_benchmark() {
+        for (size_t count : {1000, 10000, 100000}) {
+            auto index = makeIndex(generateCommands(count));
+            
+            auto start = std::chrono::steady_clock::now();
+            index = std::make_shared<SearchIndex>(index->getTree());
+            double build = elapsedMs(start);
+            
+            // Type a few queries one character at a time, then delete them
+            const std::vector<std::string> queries = {"kora", "lumitesa", "vexa nor"};
+            SearchIndex::Session session(index);
+            size_t keystrokes = 0;
+            start = std::chrono::steady_clock::now();
+            for (auto& query : queries) {
+                for (size_t length = 1; length <= query.size(); length++, keystrokes++)
+                    session.setQuery(query.substr(0, length));
+                for (size_t length = query.size(); length-- > 0; keystrokes++)
+                    session.setQuery(query.substr(0, length));
+            }
+            double perKeystroke = elapsedMs(start) / keystrokes;
+            
+            std::cout << std::endl << "Search over " << count << " commands: "
+                      << build << " ms to build, " << perKeystroke
+                      << " ms per keystroke";
+        }
+    }
+    
+  private:
+    static std::shared_ptr<SearchIndex> makeIndex(
+        const std::vector<std::pair<std::string, std::string>>& commands) {
+        std::vector<Model::command_position> paths;
+        for (auto& command : commands) {
+            command_handle entry = CommandRegistry::add(command.first,
+                                   command.second, "");
+            paths.push_back(std::make_pair(entry, std::make_shared<util::vec2i>()));
+        }
+        PathAssigner::assign(paths, GridGeometry(),
+        [](command_handle command) {
+            return 0.0;
+        });
+        return std::make_shared<SearchIndex>(Model(paths).getSharedTree());
+    }
+    
+    // Made up application names built from a handful of syllables
+    static std::vector<std::pair<std::string, std::string>> generateCommands(
+    size_t count) {
+        const std::vector<std::string> syllables = {
+            "ko", "ra", "lu", "mi", "te", "sa", "vex", "a", "nor", "qui",
+            "bel", "do", "fen", "gar", "ix", "op", "ul", "zen", "war", "cy"
+        };
+        std::mt19937 random(42);
+        std::vector<std::pair<std::string, std::string>> commands;
+        for (size_t i = 0; i < count; i++) {
+            std::string name;
+            size_t words = 1 + random() % 3;
+            for (size_t word = 0; word < words; word++) {
+                if (word > 0)
+                    name += " ";
+                size_t length = 2 + random() % 3;
+                for (size_t j = 0; j < length; j++)
+                    name += syllables[random() % syllables.size()];
+            }
+            commands.push_back(std::make_pair(name, "/usr/bin/" + name +
+                                              std::to_string(i)));
+        }
+        return commands;
+    }
+    
+    static void assertSameResults(const SearchIndex::Session& typed,
+                                  const std::shared_ptr<SearchIndex>& index) {
+        SearchIndex::Session fresh(index);
+        fresh.setQuery(typed.getQuery());
+        assert(typed.getResults() == fresh.getResults());
+    }
+    
+    static double elapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start).count();
+    }
+};